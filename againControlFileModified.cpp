@@ -35,20 +35,33 @@
 //-----------------------------------------------------------------------------
 
 #include "againcontroller.h"
+#include "againenvelope.h"
+#include "againmetadata.h"
+#include "againmeterdemand.h"
+#include "againmidilearn.h"
 #include "againparamids.h"
+#include "againprograms.h"
+#include "againsaturation.h"
+#include "againsharedmemory.h"
+#include "againstems.h"
 #include "againuimessagecontroller.h"
+#include "againuiupdates.h"
 
 #include "pluginterfaces/base/ibstream.h"
 #include "pluginterfaces/base/ustring.h"
+#include "pluginterfaces/vst/ivstautomationstate.h"
 #include "pluginterfaces/vst/ivstmidicontrollers.h"
+#include "pluginterfaces/vst/ivstmidilearn.h"
 
 #include "base/source/fstreamer.h"
 #include "base/source/fstring.h"
 
+#include "vstgui/lib/cvstguitimer.h"
 #include "vstgui/uidescription/delegationcontroller.h"
 
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 
 using namespace VSTGUI;
 
@@ -63,6 +76,7 @@ class GainParameter : public Parameter
 {
 public:
 	GainParameter (int32 flags, int32 id);
+	GainParameter (const ParameterInfo& paramInfo);
 
 	void toString (ParamValue normValue, String128 string) const SMTG_OVERRIDE;
 	bool fromString (const TChar* string, ParamValue& normValue) const SMTG_OVERRIDE;
@@ -85,6 +99,12 @@ GainParameter::GainParameter (int32 flags, int32 id)
 	setNormalized (1.f);
 }
 
+//------------------------------------------------------------------------
+GainParameter::GainParameter (const ParameterInfo& paramInfo) : Parameter (paramInfo)
+{
+	setNormalized (1.f);
+}
+
 //------------------------------------------------------------------------
 void GainParameter::toString (ParamValue normValue, String128 string) const
 {
@@ -120,6 +140,76 @@ bool GainParameter::fromString (const TChar* string, ParamValue& normValue) cons
 	return false;
 }
 
+//------------------------------------------------------------------------
+// the Parameter class itself, or its CoalescedParameter when the editor updates are coalesced
+//------------------------------------------------------------------------
+template <typename ParameterClass, typename... Args>
+static ParameterClass* newParameter (CoalescedUpdates* updates, Args&&... args)
+{
+	if (updates)
+		return new CoalescedParameter<ParameterClass> (*updates, std::forward<Args> (args)...);
+	return new ParameterClass (std::forward<Args> (args)...);
+}
+
+//------------------------------------------------------------------------
+// creates the Parameter of the right class for the (shared) metadata
+//------------------------------------------------------------------------
+static Parameter* createParameter (const ParameterMetadata& metadata, CoalescedUpdates* updates)
+{
+	switch (metadata.kind)
+	{
+		case ParameterMetadata::kGain: return newParameter<GainParameter> (updates, metadata.info);
+		case ParameterMetadata::kRange:
+			return newParameter<RangeParameter> (updates, metadata.info, metadata.minPlain,
+			                                     metadata.maxPlain);
+		case ParameterMetadata::kList:
+		{
+			// each appended string increments the step count
+			ParameterInfo info = metadata.info;
+			info.stepCount = -1;
+			auto* parameter = newParameter<StringListParameter> (updates, info);
+			for (int32 i = 0; i < metadata.numListEntries; i++)
+				parameter->appendString (metadata.listEntries[i]);
+			return parameter;
+		}
+		default: return newParameter<Parameter> (updates, metadata.info);
+	}
+}
+
+//------------------------------------------------------------------------
+static void addMetadataTo (EditControllerEx1& controller, ParameterContainer& parameters,
+                           const MetadataTable& metadata, CoalescedUpdates* updates = nullptr)
+{
+	for (const UnitInfo& unitInfo : metadata.units)
+		controller.addUnit (new Unit (unitInfo));
+	for (const ProgramListMetadata& list : metadata.programLists)
+	{
+		auto* programList = new ProgramList (list.info.name, list.info.id, list.unitId);
+		for (int32 i = 0; i < list.info.programCount; i++)
+			programList->addProgram (list.programNames[i]);
+		controller.addProgramList (programList);
+	}
+
+	parameters.init (static_cast<int32> (metadata.parameters.size ()));
+	for (const ParameterMetadata& parameter : metadata.parameters)
+		parameters.addParameter (createParameter (parameter, updates));
+}
+
+//------------------------------------------------------------------------
+static const TChar* getDefaultMessageTemplate ()
+{
+	static const struct DefaultMessage
+	{
+		String128 text {};
+		DefaultMessage ()
+		{
+			String str ("Mi primer plugin :')");
+			str.copyTo16 (text, 0, 127);
+		}
+	} message;
+	return message.text;
+}
+
 //------------------------------------------------------------------------
 // AGainController Implementation
 //------------------------------------------------------------------------
@@ -131,57 +221,19 @@ tresult PLUGIN_API AGainController::initialize (FUnknown* context)
 		return result;
 	}
 
-	//--- Create Units-------------
-	UnitInfo unitInfo;
-	Unit* unit;
-
-	// create root only if you want to use the programListId
-	/*	unitInfo.id = kRootUnitId;	// always for Root Unit
-	    unitInfo.parentUnitId = kNoParentUnitId;	// always for Root Unit
-	    Steinberg::UString (unitInfo.name, USTRINGSIZE (unitInfo.name)).assign (USTRING ("Root"));
-	    unitInfo.programListId = kNoProgramListId;
-	    
-
-	    unit = new Unit (unitInfo);
-	    addUnitInfo (unit);*/
-
-	// create a unit1 for the gain
-	unitInfo.id = 1;
-	unitInfo.parentUnitId = kRootUnitId; // attached to the root unit
+	//--- Create Units, the program list of the factory programs and Parameters from the metadata
+	// shared by all instances (their editor updates are coalesced while an editor is open, see
+	// againuiupdates.h)
+	addMetadataTo (*this, parameters, getAGainMetadata (), &uiUpdates);
 
-	Steinberg::UString (unitInfo.name, USTRINGSIZE (unitInfo.name)).assign (USTRING ("Unit1"));
-
-	unitInfo.programListId = kNoProgramListId;
-
-	unit = new Unit (unitInfo);
-	addUnit (unit);
-
-	//---Create Parameters------------
-
-	//---Gain parameter--
-	auto* gainParam = new GainParameter (ParameterInfo::kCanAutomate, kGainId);
-	parameters.addParameter (gainParam);
-
-	gainParam->setUnitID (1);
-
-	//---VuMeter parameter---
-	int32 stepCount = 0;
-	ParamValue defaultVal = 0;
-	int32 flags = ParameterInfo::kIsReadOnly;
-	int32 tag = kVuPPMId;
-	parameters.addParameter (STR16 ("VuPPM"), nullptr, stepCount, defaultVal, flags, tag);
-
-	//---Bypass parameter---
-	stepCount = 1;
-	defaultVal = 0;
-	flags = ParameterInfo::kCanAutomate | ParameterInfo::kIsBypass;
-	tag = kBypassId;
-	parameters.addParameter (STR16 ("Bypass"), nullptr, stepCount, defaultVal, flags, tag);
+	//--- MIDI mapping: the volume controller of every channel drives the gain until something else
+	// is learned (or a saved state is loaded)
+	for (const MidiMappingMetadata& mapping : getAGainMetadata ().midiMappings)
+		midiLearn.assign (0, mapping.channel, mapping.controller, mapping.id);
 
 	//---Custom state init------------
 
-	String str ("Mi primer plugin :')");
-	str.copyTo16 (defaultMessageText, 0, 127);
+	memcpy (defaultMessageText, getDefaultMessageTemplate (), sizeof (defaultMessageText));
 
 	return result;
 }
@@ -189,6 +241,9 @@ tresult PLUGIN_API AGainController::initialize (FUnknown* context)
 //------------------------------------------------------------------------
 tresult PLUGIN_API AGainController::terminate ()
 {
+	sharedDataOutbox.clear ();
+	uiUpdateTimer = nullptr;
+	uiUpdates.clear ();
 	return EditControllerEx1::terminate ();
 }
 
@@ -214,6 +269,25 @@ tresult PLUGIN_API AGainController::setComponentState (IBStream* state)
 		return kResultFalse;
 	setParamNormalized (kBypassId, bypassState ? 1 : 0);
 
+	// the saturation mode and the sidechain settings are missing in older states
+	int32 saturationMode = kSaturationOff;
+	if (streamer.readInt32 (saturationMode) == false)
+		saturationMode = kSaturationOff;
+	setParamNormalized (kSaturationId,
+	                    (ParamValue)saturationMode / (ParamValue)(kNumSaturationModes - 1));
+
+	float sidechainDepth = 0.f;
+	if (streamer.readFloat (sidechainDepth))
+	{
+		setParamNormalized (kSidechainDepthId, sidechainDepth);
+
+		double sidechainTime = 0.;
+		if (streamer.readDouble (sidechainTime))
+			setParamNormalized (kSidechainAttackId, sidechainTime);
+		if (streamer.readDouble (sidechainTime))
+			setParamNormalized (kSidechainReleaseId, sidechainTime);
+	}
+
 	return kResultOk;
 }
 
@@ -230,6 +304,76 @@ IPlugView* PLUGIN_API AGainController::createView (const char* _name)
 	return nullptr;
 }
 
+//------------------------------------------------------------------------
+void AGainController::editorAttached (EditorView* editor)
+{
+	// the processor meters only while someone looks at it (see againmeterdemand.h)
+	bool wasObserved = meterObservers.isObserved ();
+	meterObservers.numEditors++;
+	if (!wasObserved)
+		sendMeterDemand ();
+
+	// the first editor: from now on the editor updates are delivered at display rate
+	if (meterObservers.numEditors == 1)
+	{
+		uiUpdates.setDeferred (true);
+		uiUpdateTimer = makeOwned<CVSTGUITimer> ([this] (CVSTGUITimer*) { uiUpdates.flush (); },
+		                                         CoalescedUpdates::kFlushIntervalMs);
+	}
+	EditControllerEx1::editorAttached (editor);
+}
+
+//------------------------------------------------------------------------
+void AGainController::editorRemoved (EditorView* editor)
+{
+	bool wasObserved = meterObservers.isObserved ();
+	meterObservers.numEditors = std::max<int32> (meterObservers.numEditors - 1, 0);
+	if (wasObserved != meterObservers.isObserved ())
+		sendMeterDemand ();
+
+	// the last editor is gone: nothing to coalesce anymore
+	if (meterObservers.numEditors == 0 && uiUpdateTimer)
+	{
+		uiUpdateTimer->stop ();
+		uiUpdateTimer = nullptr;
+		uiUpdates.setDeferred (false);
+	}
+	EditControllerEx1::editorRemoved (editor);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainController::setAutomationState (int32 state)
+{
+	// writing automation records our outputs (the meter) as well
+	bool wasObserved = meterObservers.isObserved ();
+	meterObservers.writingAutomation = (state & kWriteState) != 0;
+	if (wasObserved != meterObservers.isObserved ())
+		sendMeterDemand ();
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainController::connect (IConnectionPoint* other)
+{
+	tresult result = EditControllerEx1::connect (other);
+	// no editor yet: tells the processor to stop metering until one is opened
+	if (result == kResultOk)
+		sendMeterDemand ();
+	return result;
+}
+
+//------------------------------------------------------------------------
+void AGainController::sendMeterDemand ()
+{
+	if (auto message = owned (allocateMessage ()))
+	{
+		message->setMessageID (kMeterDemandMessageID);
+		message->getAttributes ()->setInt (kMeterDemandObservedAttr,
+		                                   meterObservers.isObserved () ? 1 : 0);
+		sendMessage (message);
+	}
+}
+
 //------------------------------------------------------------------------
 IController* AGainController::createSubController (UTF8StringPtr name,
                                                    const IUIDescription* /*description*/,
@@ -264,9 +408,13 @@ tresult PLUGIN_API AGainController::setState (IBStream* state)
 		}
 	}
 
-	// update our editors
-	for (auto& uiMessageController : uiMessageControllers)
-		uiMessageController->setMessageText (defaultMessageText);
+	// update our editors (at the next flush when they are open, see againuiupdates.h)
+	if (!uiUpdates.defer (messageTextUpdate))
+		updateMessageText ();
+
+	// the learned MIDI mapping (appended, missing in older states)
+	if (midiLearn.read (streamer) && componentHandler)
+		componentHandler->restartComponent (kMidiCCAssignmentChanged);
 
 	return kResultTrue;
 }
@@ -287,6 +435,9 @@ tresult PLUGIN_API AGainController::getState (IBStream* state)
 	if (streamer.writeRaw (defaultMessageText, 128 * sizeof (TChar)) == false)
 		return kResultFalse;
 
+	if (midiLearn.write (streamer) == false)
+		return kResultFalse;
+
 	return kResultTrue;
 }
 
@@ -303,11 +454,95 @@ tresult AGainController::receiveText (const char* text)
 	return kResultOk;
 }
 
+//------------------------------------------------------------------------
+SharedMemoryRegion* AGainController::createSharedData (uint32 size)
+{
+	// the caller writes its payload directly into region->getData () and hands it over with
+	// sendSharedData, there is no other copy on the way to the processor.
+	// Returns nullptr if not supported, the "BinaryMessage" path has to be used in this case.
+	return SharedMemoryRegion::create (size);
+}
+
+//------------------------------------------------------------------------
+tresult AGainController::sendSharedData (SharedMemoryRegion* region)
+{
+	if (!region)
+		return kInvalidArgument;
+
+	// the payload is complete: from here on nobody can write to the region anymore
+	region->seal ();
+
+	// only the handle and the size are sent, the processor maps the region itself. The host may
+	// deliver the message later, so our descriptor stays open until the processor acknowledges it
+	// (see notify).
+	int64 id = sharedDataOutbox.add (region);
+	tresult result = kResultFalse;
+	if (auto message = owned (allocateMessage ()))
+	{
+		message->setMessageID (kSharedMemoryMessageID);
+		message->getAttributes ()->setInt (kSharedMemoryHandleAttr, region->getHandle ());
+		message->getAttributes ()->setInt (kSharedMemorySizeAttr, region->getSize ());
+		message->getAttributes ()->setInt (kSharedMemoryIdAttr, id);
+		result = sendMessage (message);
+	}
+	if (result != kResultOk)
+		sharedDataOutbox.acknowledge (id);
+	return result;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainController::notify (IMessage* message)
+{
+	if (!message)
+		return kInvalidArgument;
+
+	// the processor has mapped (or rejected) a region sent by sendSharedData
+	if (strcmp (message->getMessageID (), kSharedMemoryAckMessageID) == 0)
+	{
+		int64 id = 0;
+		if (IAttributeList* attributes = message->getAttributes ())
+		{
+			if (attributes->getInt (kSharedMemoryIdAttr, id) == kResultOk)
+				sharedDataOutbox.acknowledge (id);
+		}
+		return kResultOk;
+	}
+	return EditControllerEx1::notify (message);
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API AGainController::setParamNormalized (ParamID tag, ParamValue value)
 {
 	// called from host to update our parameters state
+	ParamValue oldValue = getParamNormalized (tag);
 	tresult result = EditControllerEx1::setParamNormalized (tag, value);
+
+	// the oversampling of the saturation changes the latency of the processor
+	if (result == kResultOk && tag == kSaturationId && componentHandler &&
+	    saturationModeFromNormalized (oldValue) != saturationModeFromNormalized (value))
+	{
+		componentHandler->restartComponent (kLatencyChanged);
+	}
+
+	// the learn switch of the editor (see againmidilearn.h)
+	if (result == kResultOk && tag == kMidiLearnId)
+		midiLearn.setLearning (value > 0.5);
+
+	// a program change shows the values of the new program, the processor applies the same
+	// snapshot itself at the sample offset of the change
+	if (result == kResultOk && tag == kProgramId &&
+	    programFromNormalized (oldValue) != programFromNormalized (value))
+	{
+		const ParameterSnapshot& program = getPrograms ().snapshots[programFromNormalized (value)];
+		setParamNormalized (kGainId, program.fGain);
+		setParamNormalized (kSaturationId, (ParamValue)program.saturationMode /
+		                                       (ParamValue)(kNumSaturationModes - 1));
+		setParamNormalized (kSidechainDepthId, program.fSidechainDepth);
+		setParamNormalized (kSidechainAttackId, program.fSidechainAttack);
+		setParamNormalized (kSidechainReleaseId, program.fSidechainRelease);
+		if (componentHandler)
+			componentHandler->restartComponent (kParamValuesChanged);
+	}
 	return result;
 }
 
@@ -373,6 +608,14 @@ void AGainController::removeUIMessageController (UIMessageController* controller
 		uiMessageControllers.erase (it);
 }
 
+//------------------------------------------------------------------------
+void AGainController::updateMessageText ()
+{
+	// one pass over all message controllers of all open editors
+	for (auto& uiMessageController : uiMessageControllers)
+		uiMessageController->setMessageText (defaultMessageText);
+}
+
 //------------------------------------------------------------------------
 void AGainController::setDefaultMessageText (String128 text)
 {
@@ -390,22 +633,150 @@ TChar* AGainController::getDefaultMessageText ()
 tresult PLUGIN_API AGainController::queryInterface (const char* iid, void** obj)
 {
 	QUERY_INTERFACE (iid, obj, IMidiMapping::iid, IMidiMapping)
+	QUERY_INTERFACE (iid, obj, IMidiLearn::iid, IMidiLearn)
+	QUERY_INTERFACE (iid, obj, IAutomationState::iid, IAutomationState)
 	return EditControllerEx1::queryInterface (iid, obj);
 }
 
 //------------------------------------------------------------------------
 tresult PLUGIN_API AGainController::getMidiControllerAssignment (int32 busIndex,
-                                                                 int16 /*midiChannel*/,
+                                                                 int16 midiChannel,
                                                                  CtrlNumber midiControllerNumber,
                                                                  ParamID& tag)
 {
-	// we support for the Gain parameter all MIDI Channel but only first bus (there is only one!)
-	if (busIndex == 0 && midiControllerNumber == kCtrlVolume)
+	// any parameter can be assigned to each bus, channel and controller (learned in the editor)
+	return midiLearn.lookup (busIndex, midiChannel, midiControllerNumber, tag) ? kResultTrue :
+	                                                                            kResultFalse;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainController::onLiveMIDIControllerInput (int32 busIndex, int16 channel,
+                                                               CtrlNumber midiCC)
+{
+	// while learning, the controller moved by the user is assigned to the last touched parameter
+	if (midiLearn.learn (busIndex, channel, midiCC))
+	{
+		EditControllerEx1::setParamNormalized (kMidiLearnId, 0.);
+		if (componentHandler)
+			componentHandler->restartComponent (kMidiCCAssignmentChanged);
+	}
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult AGainController::beginEdit (ParamID tag)
+{
+	// the editor touches a parameter: the target of the learn mode
+	midiLearn.touch (tag);
+	return EditControllerEx1::beginEdit (tag);
+}
+
+//------------------------------------------------------------------------
+// AGainStemsController Implementation
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::initialize (FUnknown* context)
+{
+	tresult result = EditControllerEx1::initialize (context);
+	if (result != kResultOk)
+		return result;
+
+	// one unit per stem with its gain, bypass and meter (see againmetadata.h)
+	addMetadataTo (*this, parameters, getStemsMetadata ());
+
+	// the volume controller of MIDI channel n drives the gain of stem n (see againmetadata.h)
+	for (const MidiMappingMetadata& mapping : getStemsMetadata ().midiMappings)
+		midiLearn.assign (0, mapping.channel, mapping.controller, mapping.id);
+
+	return result;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::setComponentState (IBStream* state)
+{
+	if (!state)
+		return kResultFalse;
+
+	IBStreamer streamer (state, kLittleEndian);
+	int32 version = 0;
+	int32 numStems = 0;
+	if (streamer.readInt32 (version) == false || version != AGainStems::kStateVersion)
+		return kResultFalse;
+	if (streamer.readInt32 (numStems) == false)
+		return kResultFalse;
+
+	for (int32 i = 0; i < std::min (numStems, kNumStemBuses); i++)
 	{
-		tag = kGainId;
-		return kResultTrue;
+		float savedGain = 0.f;
+		int32 bypassState = 0;
+		if (streamer.readFloat (savedGain) == false || streamer.readInt32 (bypassState) == false)
+			return kResultFalse;
+		setParamNormalized (kStemGainBaseId + i, savedGain);
+		setParamNormalized (kStemBypassBaseId + i, bypassState ? 1 : 0);
 	}
-	return kResultFalse;
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::setState (IBStream* state)
+{
+	// the controller state is the learned MIDI mapping (missing in older states, the current one
+	// is kept then)
+	IBStreamer streamer (state, kLittleEndian);
+	if (midiLearn.read (streamer) && componentHandler)
+		componentHandler->restartComponent (kMidiCCAssignmentChanged);
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::getState (IBStream* state)
+{
+	IBStreamer streamer (state, kLittleEndian);
+	return midiLearn.write (streamer) ? kResultOk : kResultFalse;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::setParamNormalized (ParamID tag, ParamValue value)
+{
+	tresult result = EditControllerEx1::setParamNormalized (tag, value);
+	if (result == kResultOk && tag == kMidiLearnId)
+		midiLearn.setLearning (value > 0.5);
+	return result;
+}
+
+//------------------------------------------------------------------------
+tresult AGainStemsController::beginEdit (ParamID tag)
+{
+	midiLearn.touch (tag);
+	return EditControllerEx1::beginEdit (tag);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::getMidiControllerAssignment (
+    int32 busIndex, int16 channel, CtrlNumber midiControllerNumber, ParamID& tag)
+{
+	return midiLearn.lookup (busIndex, channel, midiControllerNumber, tag) ? kResultTrue :
+	                                                                        kResultFalse;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::onLiveMIDIControllerInput (int32 busIndex, int16 channel,
+                                                                    CtrlNumber midiCC)
+{
+	if (midiLearn.learn (busIndex, channel, midiCC))
+	{
+		EditControllerEx1::setParamNormalized (kMidiLearnId, 0.);
+		if (componentHandler)
+			componentHandler->restartComponent (kMidiCCAssignmentChanged);
+	}
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStemsController::queryInterface (const char* iid, void** obj)
+{
+	QUERY_INTERFACE (iid, obj, IMidiMapping::iid, IMidiMapping)
+	QUERY_INTERFACE (iid, obj, IMidiLearn::iid, IMidiLearn)
+	return EditControllerEx1::queryInterface (iid, obj);
 }
 
 //------------------------------------------------------------------------
@@ -0,0 +1,273 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againanalysis.h
+// Description : Meter analysis of AGain outside the audio thread
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againarena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// AnalysisRing: single producer (audio thread), single consumer (analysis thread) ring with one
+// float channel after the other. The memory comes from the ProcessArena; a full ring drops the
+// block (the meter misses it, the audio never waits). A block is copied channel by channel in at
+// most two contiguous parts (memcpy for Sample32).
+//------------------------------------------------------------------------
+class AnalysisRing
+{
+public:
+	// the analysis thread drains every AnalysisThread::kIntervalMs: plenty of headroom up to
+	// 384 kHz
+	static constexpr int32 kDefaultCapacityFrames = 8192;
+
+	void setup (ProcessArena& arena, int32 numChannels, int32 capacityFrames)
+	{
+		channels = std::max<int32> (numChannels, 1);
+		buffer = nullptr;
+		readPosition.store (0);
+		writePosition.store (0);
+		if (capacityFrames <= 0) // not used
+			return;
+		capacity = 1;
+		while (capacity < (uint64)capacityFrames)
+			capacity *= 2;
+		buffer = arena.allocate<float> (capacity * channels);
+	}
+
+	//--- audio thread ---
+	template <typename SampleType>
+	bool push (SampleType** in, int32 numChannels, int32 sampleFrames)
+	{
+		if (!buffer)
+			return false;
+		uint64 write = writePosition.load (std::memory_order_relaxed);
+		uint64 read = readPosition.load (std::memory_order_acquire);
+		if (capacity - (write - read) < (uint64)sampleFrames)
+			return false;
+
+		numChannels = std::min (numChannels, channels);
+		uint64 offset = write & (capacity - 1);
+		int32 first = (int32)std::min<uint64> (sampleFrames, capacity - offset);
+		for (int32 c = 0; c < channels; c++)
+		{
+			float* channel = buffer + c * capacity;
+			if (c < numChannels)
+			{
+				copySamples (in[c], channel + offset, first);
+				copySamples (in[c] + first, channel, sampleFrames - first);
+			}
+			else
+			{
+				memset (channel + offset, 0, first * sizeof (float));
+				memset (channel, 0, (sampleFrames - first) * sizeof (float));
+			}
+		}
+		writePosition.store (write + sampleFrames, std::memory_order_release);
+		return true;
+	}
+
+	//--- analysis thread: calls func (const float* samples, int32 numSamples) for all available
+	// data, per channel in contiguous parts
+	template <typename Func>
+	void consume (Func&& func)
+	{
+		uint64 read = readPosition.load (std::memory_order_relaxed);
+		uint64 write = writePosition.load (std::memory_order_acquire);
+		while (read != write)
+		{
+			// contiguous part up to the end of the buffer
+			uint64 offset = read & (capacity - 1);
+			uint64 count = std::min<uint64> (write - read, capacity - offset);
+			for (int32 c = 0; c < channels; c++)
+				func (buffer + c * capacity + offset, (int32)count);
+			read += count;
+		}
+		readPosition.store (read, std::memory_order_release);
+	}
+
+	int32 getNumChannels () const { return channels; }
+
+//------------------------------------------------------------------------
+private:
+	static void copySamples (const float* in, float* out, int32 count)
+	{
+		memcpy (out, in, count * sizeof (float));
+	}
+
+	static void copySamples (const double* in, float* out, int32 count)
+	{
+		for (int32 i = 0; i < count; i++)
+			out[i] = (float)in[i];
+	}
+
+	float* buffer {nullptr};
+	uint64 capacity {0}; // in frames (per channel), a power of 2
+	int32 channels {1};
+	std::atomic<uint64> readPosition {0};
+	std::atomic<uint64> writePosition {0};
+};
+
+//------------------------------------------------------------------------
+// AnalysisWorker: the meter analysis of one instance (further display analysis, loudness or
+// spectra, belongs here as well). While started, the shared AnalysisThread drains its ring. The
+// audio thread only reads the last published result, it reaches the controller with the usual
+// output parameter.
+//------------------------------------------------------------------------
+class AnalysisWorker
+{
+public:
+	~AnalysisWorker () { stop (); }
+
+	// non realtime thread (setActive)
+	inline void start (AnalysisRing& analysisRing, bool absolutePeak);
+	inline void stop ();
+
+	bool isRunning () const { return running; }
+
+	//--- audio thread ---
+	float getVuPPM () const { return vuPPM.load (std::memory_order_relaxed); }
+
+	// forgets the meter of the blocks before a metering pause (see againmeterdemand.h)
+	void resetVuPPM () { vuPPM.store (0.f, std::memory_order_relaxed); }
+
+	//--- analysis thread ---
+	void drain ()
+	{
+		bool hasData = false;
+		float peak = 0.f;
+		ring->consume ([&] (const float* samples, int32 count) {
+			hasData = hasData || count > 0;
+			if (absolute)
+			{
+				for (int32 i = 0; i < count; i++)
+					peak = std::max (peak, std::abs (samples[i]));
+			}
+			else
+			{
+				// check only positive values (as processVuPPM does)
+				for (int32 i = 0; i < count; i++)
+					peak = std::max (peak, samples[i]);
+			}
+		});
+		if (hasData)
+			vuPPM.store (peak, std::memory_order_relaxed);
+	}
+
+//------------------------------------------------------------------------
+private:
+	AnalysisRing* ring {nullptr};
+	bool absolute {false};
+	bool running {false};
+	std::atomic<float> vuPPM {0.f};
+};
+
+//------------------------------------------------------------------------
+// AnalysisThread: one background thread per process drains the rings of all started
+// AnalysisWorkers every kIntervalMs. It sleeps without waking up while no worker is started.
+//------------------------------------------------------------------------
+class AnalysisThread
+{
+public:
+	static constexpr int32 kIntervalMs = 5;
+
+	static AnalysisThread& instance ()
+	{
+		static AnalysisThread analysisThread;
+		return analysisThread;
+	}
+
+	void add (AnalysisWorker* worker)
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			workers.push_back (worker);
+			if (!thread.joinable ())
+				thread = std::thread ([this] () { run (); });
+		}
+		condition.notify_all ();
+	}
+
+	// the worker is not drained anymore when this returns
+	void remove (AnalysisWorker* worker)
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		workers.erase (std::remove (workers.begin (), workers.end (), worker), workers.end ());
+	}
+
+//------------------------------------------------------------------------
+private:
+	~AnalysisThread ()
+	{
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			quit = true;
+		}
+		condition.notify_all ();
+		if (thread.joinable ())
+			thread.join ();
+	}
+
+	void run ()
+	{
+		std::unique_lock<std::mutex> lock (mutex);
+		while (!quit)
+		{
+			if (workers.empty ())
+			{
+				condition.wait (lock);
+				continue;
+			}
+			condition.wait_for (lock, std::chrono::milliseconds (kIntervalMs));
+			for (AnalysisWorker* worker : workers)
+				worker->drain ();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<AnalysisWorker*> workers;
+	bool quit {false};
+	std::thread thread;
+};
+
+//------------------------------------------------------------------------
+inline void AnalysisWorker::start (AnalysisRing& analysisRing, bool absolutePeak)
+{
+	stop ();
+	ring = &analysisRing;
+	absolute = absolutePeak;
+	vuPPM.store (0.f);
+	running = true;
+	AnalysisThread::instance ().add (this);
+}
+
+//------------------------------------------------------------------------
+inline void AnalysisWorker::stop ()
+{
+	if (!running)
+		return;
+	AnalysisThread::instance ().remove (this);
+	running = false;
+	ring = nullptr;
+}
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
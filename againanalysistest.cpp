@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againanalysistest.cpp
+// Description : Stress test of the AnalysisRing and AnalysisWorker (build it with
+//               -fsanitize=thread)
+//-----------------------------------------------------------------------------
+#include "againanalysis.h"
+
+#include <cstdio>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// ring:   an audio thread pushes a counter (channel 0) and its negation (channel 1) in blocks of
+//         1..300 frames into a ring of 1024 frames (it wraps every few blocks), a full ring makes
+//         it push the same block again. The analysis thread consumes concurrently and has to see
+//         every frame exactly once and in order.
+// worker: the AnalysisThread drains two started workers (positive and absolute peak, float and
+//         double blocks) until their meters show the peaks of the pushed blocks.
+// Returns 0 when every check passed; ThreadSanitizer reports any data race on top.
+//------------------------------------------------------------------------
+static constexpr int32 kNumFrames = 1000000; // exact in float (below 2^24)
+static constexpr int32 kCapacityFrames = 1024;
+
+//------------------------------------------------------------------------
+static int32 testRing ()
+{
+	ProcessArena arena;
+	AnalysisRing ring;
+	arena.beginMeasure ();
+	ring.setup (arena, 2, kCapacityFrames);
+	arena.commit (false);
+	ring.setup (arena, 2, kCapacityFrames);
+
+	std::atomic<bool> producerDone {false};
+	int32 failures = 0;
+	int32 full = 0;
+
+	std::thread audio ([&] () {
+		float block[2][300];
+		float* channels[2] = {block[0], block[1]};
+		int32 frame = 0;
+		int32 blockSize = 1;
+		while (frame < kNumFrames)
+		{
+			int32 count = std::min (blockSize, kNumFrames - frame);
+			for (int32 i = 0; i < count; i++)
+			{
+				block[0][i] = (float)(frame + i);
+				block[1][i] = -(float)(frame + i);
+			}
+			while (!ring.push (channels, 2, count))
+			{
+				full++;
+				std::this_thread::yield ();
+			}
+			frame += count;
+			blockSize = blockSize % 293 + 7; // 1, 8, .. 295, 9, 16, ..
+		}
+		producerDone = true;
+	});
+
+	int32 expected[2] = {0, 0};
+	int32 channel = 0;
+	auto check = [&] (const float* samples, int32 count) {
+		float sign = channel == 0 ? 1.f : -1.f;
+		for (int32 i = 0; i < count; i++)
+		{
+			if (samples[i] != sign * (float)(expected[channel] + i))
+				failures++;
+		}
+		expected[channel] += count;
+		channel = 1 - channel;
+	};
+	bool drained = false;
+	while (!drained)
+	{
+		// one more round after the producer is done picks up its last block
+		drained = producerDone.load ();
+		ring.consume (check);
+	}
+	audio.join ();
+
+	if (expected[0] != kNumFrames || expected[1] != kNumFrames)
+		failures++;
+	fprintf (stderr, "[againanalysistest] ring: %d frames, ring full %d times, %d failures\n",
+	         expected[0], full, failures);
+	return failures;
+}
+
+//------------------------------------------------------------------------
+static int32 testWorkers ()
+{
+	ProcessArena arena32, arena64;
+	AnalysisRing ring32, ring64;
+	arena32.beginMeasure ();
+	ring32.setup (arena32, 2, AnalysisRing::kDefaultCapacityFrames);
+	arena32.commit (false);
+	ring32.setup (arena32, 2, AnalysisRing::kDefaultCapacityFrames);
+	arena64.beginMeasure ();
+	ring64.setup (arena64, 3, AnalysisRing::kDefaultCapacityFrames);
+	arena64.commit (false);
+	ring64.setup (arena64, 3, AnalysisRing::kDefaultCapacityFrames);
+
+	AnalysisWorker positive, absolute;
+	positive.start (ring32, false);
+	absolute.start (ring64, true);
+
+	// positive peak 0.7 (channel 1), absolute peak 0.9 (a negative sample of channel 2)
+	float left[300], right[300];
+	double samples64[3][300];
+	for (int32 i = 0; i < 300; i++)
+	{
+		left[i] = 0.1f;
+		right[i] = -0.8f;
+		samples64[0][i] = samples64[1][i] = samples64[2][i] = -0.2;
+	}
+	right[123] = 0.7f;
+	samples64[2][5] = -0.9;
+	float* in32[2] = {left, right};
+	double* in64[3] = {samples64[0], samples64[1], samples64[2]};
+
+	int32 failures = 0;
+	for (int32 block = 0; block < 10; block++)
+	{
+		if (!ring32.push (in32, 2, 300) || !ring64.push (in64, 3, 300))
+			failures++; // the rings hold 8192 frames
+	}
+	for (int32 wait = 0; wait < 1000; wait++)
+	{
+		if (positive.getVuPPM () == 0.7f && absolute.getVuPPM () == 0.9f)
+			break;
+		std::this_thread::sleep_for (std::chrono::milliseconds (1));
+	}
+	if (positive.getVuPPM () != 0.7f || absolute.getVuPPM () != 0.9f)
+		failures++;
+
+	// a stopped worker is not drained anymore, a restarted one starts from silence
+	positive.stop ();
+	absolute.stop ();
+	positive.start (ring32, false);
+	if (positive.getVuPPM () != 0.f)
+		failures++;
+	positive.stop ();
+
+	fprintf (stderr, "[againanalysistest] workers: %d failures\n", failures);
+	return failures;
+}
+
+//------------------------------------------------------------------------
+int main ()
+{
+	int32 failures = testRing ();
+	failures += testWorkers ();
+	return failures == 0 ? 0 : 1;
+}
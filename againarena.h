@@ -0,0 +1,174 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againarena.h
+// Description : Per instance memory arena for all AGain processing buffers
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+#include <sys/mman.h>
+#endif
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// ProcessArena: one cache line aligned block per instance, carved into all processing buffers in
+// setupProcessing. Sizing is done with two passes of the same setup code: the first pass only
+// measures (allocate returns nullptr), commit allocates the measured size and the second pass gets
+// the real memory. Nothing is ever freed individually, the whole arena is released or rebuilt.
+//------------------------------------------------------------------------
+class ProcessArena
+{
+public:
+	static constexpr size_t kAlignment = 64; // cache line
+	static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+	ProcessArena () = default;
+	ProcessArena (const ProcessArena&) = delete;
+	ProcessArena& operator= (const ProcessArena&) = delete;
+	~ProcessArena () { release (); }
+
+	void beginMeasure ()
+	{
+		release ();
+		measuring = true;
+		used = 0;
+	}
+
+	// allocates the measured size; with hugePages, large arenas are backed by huge pages if the
+	// system has some (falls back to normal pages)
+	bool commit (bool hugePages)
+	{
+		size_t size = (used + kAlignment - 1) & ~(kAlignment - 1);
+		measuring = false;
+		used = 0;
+		if (size == 0)
+			return true;
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+		if (hugePages && size >= kHugePageSize)
+		{
+			size_t hugeSize = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+			void* ptr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+			ptr = mmap (nullptr, hugeSize, PROT_READ | PROT_WRITE,
+			            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+			if (ptr == MAP_FAILED)
+			{
+				ptr = mmap (nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+				            -1, 0);
+#if defined(MADV_HUGEPAGE)
+				if (ptr != MAP_FAILED)
+					madvise (ptr, hugeSize, MADV_HUGEPAGE); // transparent huge pages
+#endif
+			}
+			if (ptr != MAP_FAILED)
+			{
+				memory = static_cast<uint8*> (ptr);
+				capacity = hugeSize;
+				mapped = true;
+				return true;
+			}
+		}
+#endif
+		memory = static_cast<uint8*> (::operator new (size, std::align_val_t (kAlignment)));
+		capacity = size;
+		return true;
+	}
+
+	// returns count value-initialized objects, nullptr while measuring
+	template <typename T>
+	T* allocate (size_t count)
+	{
+		static_assert (std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+		static_assert (alignof (T) <= kAlignment, "");
+
+		size_t offset = (used + kAlignment - 1) & ~(kAlignment - 1);
+		size_t bytes = count * sizeof (T);
+		if (measuring)
+		{
+			used = offset + bytes;
+			return nullptr;
+		}
+		if (offset + bytes > capacity)
+		{
+			assert (false && "setup code differs between measure and allocation pass");
+			return nullptr;
+		}
+		used = offset + bytes;
+		T* ptr = reinterpret_cast<T*> (memory + offset);
+		for (size_t i = 0; i < count; i++)
+			new (ptr + i) T ();
+		return ptr;
+	}
+
+	void release ()
+	{
+		if (!memory)
+			return;
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+		if (mapped)
+			munmap (memory, capacity);
+		else
+#endif
+			::operator delete (memory, std::align_val_t (kAlignment));
+		memory = nullptr;
+		capacity = 0;
+		used = 0;
+		mapped = false;
+	}
+
+	size_t getCapacity () const { return capacity; }
+	size_t getUsed () const { return used; }
+
+//------------------------------------------------------------------------
+private:
+	uint8* memory {nullptr};
+	size_t capacity {0};
+	size_t used {0};
+	bool measuring {false};
+	bool mapped {false};
+};
+
+//------------------------------------------------------------------------
+// Debug mode (AGAIN_ASSERT_NO_ALLOCATIONS=1): again.cpp replaces operator new/delete for this
+// module and asserts when anything is allocated while a ScopedNoAllocation is alive in this
+// thread (the whole process call).
+//------------------------------------------------------------------------
+#ifndef AGAIN_ASSERT_NO_ALLOCATIONS
+#define AGAIN_ASSERT_NO_ALLOCATIONS 0
+#endif
+
+#if AGAIN_ASSERT_NO_ALLOCATIONS
+inline bool& noAllocationScope ()
+{
+	static thread_local bool active = false;
+	return active;
+}
+
+struct ScopedNoAllocation
+{
+	ScopedNoAllocation () : previous (noAllocationScope ()) { noAllocationScope () = true; }
+	~ScopedNoAllocation () { noAllocationScope () = previous; }
+	bool previous;
+};
+#else
+struct ScopedNoAllocation
+{
+};
+#endif
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,174 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againautotune.h
+// Description : Chooses the fastest kernel variant and tile size of AGain on this machine
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againpipeline.h"
+#include "againtiling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+struct KernelChoice
+{
+	KernelVariant variant {kKernelGeneric};
+	int32 tileFrames {kMaxTileFrames};
+	bool floatCompute {false}; // kPipelineFloatCompute (kSample64 only)
+};
+
+//------------------------------------------------------------------------
+// Micro benchmark of the gain pipeline (the common path) for the real channel count and block
+// size: first every supported variant with the cache derived tile size, then a few tile sizes
+// around it with the winner. The widest variant is not always the fastest (AVX-512 lowers the
+// clock on some CPUs), so it has to prove itself. The same holds for the float computing pipelines
+// of a kSample64 host (tryFloatCompute): they are only chosen when they beat double precision.
+// The result is cached per configuration for the lifetime of the process, further instances
+// (and setupProcessing calls) get it without measuring again.
+//
+// AGAIN_KERNEL=generic|avx2|avx512 forces a variant (if the CPU supports it), AGAIN_TILE_FRAMES
+// (see computeTileFrames) keeps the tile size fixed.
+//------------------------------------------------------------------------
+class KernelAutotuner
+{
+public:
+	static KernelChoice choose (int32 numChannels, int32 maxSamplesPerBlock, bool sample64,
+	                            int32 defaultTileFrames, bool tryFloatCompute = false)
+	{
+		tryFloatCompute = tryFloatCompute && sample64;
+		numChannels = std::max<int32> (numChannels, 1);
+		maxSamplesPerBlock = std::max<int32> (maxSamplesPerBlock, 1);
+
+		static std::mutex mutex;
+		static std::map<std::tuple<int32, int32, bool, int32, bool>, KernelChoice> cache;
+		std::lock_guard<std::mutex> lock (mutex);
+		auto key = std::make_tuple (numChannels, maxSamplesPerBlock, sample64, defaultTileFrames,
+		                            tryFloatCompute);
+		auto it = cache.find (key);
+		if (it != cache.end ())
+			return it->second;
+
+		KernelChoice choice =
+		    sample64 ?
+		        measure<Sample64> (numChannels, maxSamplesPerBlock, defaultTileFrames,
+		                           tryFloatCompute) :
+		        measure<Sample32> (numChannels, maxSamplesPerBlock, defaultTileFrames, false);
+		cache[key] = choice;
+		return choice;
+	}
+
+//------------------------------------------------------------------------
+private:
+	static constexpr int32 kRuns = 5; // the fastest run counts
+	static constexpr int32 kBlocksPerRun = 8;
+
+	static bool getForcedVariant (KernelVariant& variant)
+	{
+		const char* env = getenv ("AGAIN_KERNEL");
+		if (!env)
+			return false;
+		for (int32 i = 0; i < kNumKernelVariants; i++)
+		{
+			if (strcmp (env, getKernelVariantName ((KernelVariant)i)) == 0 &&
+			    isKernelVariantSupported ((KernelVariant)i))
+			{
+				variant = (KernelVariant)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <typename SampleType>
+	static KernelChoice measure (int32 numChannels, int32 frames, int32 defaultTileFrames,
+	                             bool tryFloatCompute)
+	{
+		std::vector<SampleType> inData ((size_t)numChannels * frames);
+		std::vector<SampleType> outData ((size_t)numChannels * frames);
+		std::vector<SampleType*> in (numChannels);
+		std::vector<SampleType*> out (numChannels);
+		for (int32 i = 0; i < numChannels; i++)
+		{
+			in[i] = inData.data () + (size_t)i * frames;
+			out[i] = outData.data () + (size_t)i * frames;
+		}
+		for (size_t n = 0; n < inData.size (); n++)
+			inData[n] = (SampleType) ((int32 (n * 7919) % 2001) - 1000) * (SampleType)0.0005;
+
+		PipelineContext context;
+		context.gain = 0.5f;
+		auto run = [&] (KernelVariant variant, int32 tileFrames, uint32 flags = 0) {
+			PipelineFunction<SampleType> function = getPipeline<SampleType> (flags, variant);
+			double best = 1e30;
+			for (int32 r = 0; r < kRuns; r++)
+			{
+				auto start = std::chrono::steady_clock::now ();
+				for (int32 b = 0; b < kBlocksPerRun; b++)
+					function (in.data (), out.data (), numChannels, frames, tileFrames, context);
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+				best = std::min (best, elapsed.count ());
+			}
+			return best;
+		};
+
+		KernelChoice choice;
+		choice.tileFrames = defaultTileFrames;
+		if (!getForcedVariant (choice.variant))
+		{
+			double bestTime = 1e30;
+			for (int32 i = 0; i < kNumKernelVariants; i++)
+			{
+				if (!isKernelVariantSupported ((KernelVariant)i))
+					continue;
+				double time = run ((KernelVariant)i, defaultTileFrames);
+				if (time < bestTime)
+				{
+					bestTime = time;
+					choice.variant = (KernelVariant)i;
+				}
+			}
+		}
+
+		if (getenv ("AGAIN_TILE_FRAMES") == nullptr)
+		{
+			double bestTime = 1e30;
+			const int32 candidates[] = {defaultTileFrames / 2, defaultTileFrames,
+			                            defaultTileFrames * 2, defaultTileFrames * 4};
+			for (int32 tileFrames : candidates)
+			{
+				tileFrames = std::max<int32> (tileFrames, kMinTileFrames);
+				double time = run (choice.variant, tileFrames);
+				if (time < bestTime)
+				{
+					bestTime = time;
+					choice.tileFrames = tileFrames;
+				}
+			}
+		}
+
+		// float computing pipelines (kSample64 only) with the chosen variant and tile size
+		if (tryFloatCompute)
+			choice.floatCompute = run (choice.variant, choice.tileFrames, kPipelineFloatCompute) <
+			                      run (choice.variant, choice.tileFrames);
+		return choice;
+	}
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,420 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againbenchmark.cpp
+// Description : Benchmarks of the AGain classes (linked against the plugin sources)
+//-----------------------------------------------------------------------------
+#include "again.h"
+#include "againcontroller.h"
+#include "againconvolution.h"
+#include "againperfcounters.h" // for AGAIN_PERF_COUNTERS
+#include "againpipeline.h"
+
+#include "public.sdk/source/vst/hosting/eventlist.h"
+#include "public.sdk/source/vst/hosting/hostclasses.h"
+#include "public.sdk/source/vst/hosting/parameterchanges.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// Heap accounting: every allocation of the process is counted, the benchmarks report the bytes
+// still allocated per instance (the size is stored in front of each block).
+//------------------------------------------------------------------------
+static std::atomic<int64> liveBytes {0};
+static constexpr size_t kSizeHeader = alignof (std::max_align_t);
+
+void* operator new (size_t size)
+{
+	auto* block = static_cast<uint8*> (malloc (size + kSizeHeader));
+	if (!block)
+		throw std::bad_alloc ();
+	memcpy (block, &size, sizeof (size));
+	liveBytes += (int64)size;
+	return block + kSizeHeader;
+}
+
+void operator delete (void* ptr) noexcept
+{
+	if (!ptr)
+		return;
+	auto* block = static_cast<uint8*> (ptr) - kSizeHeader;
+	size_t size;
+	memcpy (&size, block, sizeof (size));
+	liveBytes -= (int64)size;
+	free (block);
+}
+
+void* operator new[] (size_t size) { return operator new (size); }
+void operator delete[] (void* ptr) noexcept { operator delete (ptr); }
+void operator delete (void* ptr, size_t) noexcept { operator delete (ptr); }
+void operator delete[] (void* ptr, size_t) noexcept { operator delete (ptr); }
+
+//------------------------------------------------------------------------
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMicroseconds (Clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro> (Clock::now () - start).count ();
+}
+
+//------------------------------------------------------------------------
+// Instantiation: create + initialize of processor and controller, like a host loading a
+// project with numInstances instances. The first run includes the metadata built once per
+// process (see againmetadata.h).
+//------------------------------------------------------------------------
+static void benchmarkInstantiation (HostApplication& host, int32 numInstances)
+{
+	std::vector<IAudioProcessor*> processors;
+	std::vector<IEditController*> controllers;
+	processors.reserve (numInstances);
+	controllers.reserve (numInstances);
+
+	int64 bytesBefore = liveBytes.load ();
+	auto start = Clock::now ();
+	for (int32 i = 0; i < numInstances; i++)
+	{
+		auto* processor = static_cast<IAudioProcessor*> (AGain::createInstance (nullptr));
+		auto* controller =
+		    static_cast<IEditController*> (AGainController::createInstance (nullptr));
+		FUnknownPtr<IPluginBase> (processor)->initialize (&host);
+		controller->initialize (&host);
+		processors.push_back (processor);
+		controllers.push_back (controller);
+	}
+	double time = elapsedMicroseconds (start);
+	int64 bytes = liveBytes.load () - bytesBefore;
+
+	printf ("instantiation  %5d instances: %8.2f us, %8lld bytes per instance\n", numInstances,
+	        time / numInstances, (long long)(bytes / numInstances));
+
+	for (int32 i = 0; i < numInstances; i++)
+	{
+		controllers[i]->terminate ();
+		controllers[i]->release ();
+		FUnknownPtr<IPluginBase> (processors[i])->terminate ();
+		processors[i]->release ();
+	}
+}
+
+//------------------------------------------------------------------------
+// BenchmarkProcessor: an active stereo AGain processor with host side buffers, empty parameter
+// changes and events, processing Sample32 blocks of up to maxFrames frames of a sine.
+//------------------------------------------------------------------------
+class BenchmarkProcessor
+{
+public:
+	BenchmarkProcessor (HostApplication& host, int32 maxFrames)
+	: processor (static_cast<IAudioProcessor*> (AGain::createInstance (nullptr)))
+	, component (processor)
+	, outputChanges (8)
+	{
+		component->initialize (&host);
+		ProcessSetup setup {kRealtime, kSample32, maxFrames, 48000.};
+		processor->setupProcessing (setup);
+		component->setActive (true);
+		processor->setProcessing (true);
+
+		for (auto& samples : buffers)
+			samples.assign (maxFrames, 0.f);
+		for (int32 n = 0; n < maxFrames; n++)
+			buffers[0][n] = buffers[1][n] = 0.5f * std::sin (0.1f * n);
+		for (int32 c = 0; c < 2; c++)
+		{
+			inputChannels[c] = buffers[c].data ();
+			outputChannels[c] = buffers[2 + c].data ();
+		}
+		input.numChannels = 2;
+		input.channelBuffers32 = inputChannels;
+		output.numChannels = 2;
+		output.channelBuffers32 = outputChannels;
+
+		data.processMode = kRealtime;
+		data.symbolicSampleSize = kSample32;
+		data.numInputs = 1;
+		data.inputs = &input;
+		data.numOutputs = 1;
+		data.outputs = &output;
+		data.inputParameterChanges = &inputChanges;
+		data.outputParameterChanges = &outputChanges;
+		data.inputEvents = &events;
+	}
+
+	// setActive (false) prints the performance counters if they are enabled
+	~BenchmarkProcessor ()
+	{
+		processor->setProcessing (false);
+		component->setActive (false);
+		component->terminate ();
+		processor->release ();
+	}
+
+	// returns the time per call in ns
+	double process (int32 frames, int32 numCalls)
+	{
+		data.numSamples = frames;
+		auto start = Clock::now ();
+		for (int32 i = 0; i < numCalls; i++)
+		{
+			outputChanges.clearQueue ();
+			processor->process (data);
+		}
+		return elapsedMicroseconds (start) * 1000. / numCalls;
+	}
+
+//------------------------------------------------------------------------
+private:
+	IAudioProcessor* processor;
+	FUnknownPtr<IComponent> component;
+	std::vector<float> buffers[4];
+	float* inputChannels[2] {};
+	float* outputChannels[2] {};
+	AudioBusBuffers input;
+	AudioBusBuffers output;
+	ParameterChanges inputChanges;
+	ParameterChanges outputChanges;
+	EventList events;
+	ProcessData data;
+};
+
+//------------------------------------------------------------------------
+// Small blocks: fixed cost of a process call (see againsmallblock.h) with 1..32 frames, like a
+// host splitting its blocks at automation points.
+//------------------------------------------------------------------------
+static void benchmarkSmallBlocks (HostApplication& host)
+{
+	// fixed cost target per call of againsmallblock.h, 1 frame is (almost) nothing but fixed cost
+	constexpr double kTargetNanoseconds = 100.;
+
+	BenchmarkProcessor processor (host, 32);
+	for (int32 frames : {1, 2, 4, 8, 16, 32})
+	{
+		double time = processor.process (frames, 1000000);
+		printf ("small blocks   %5d frames:    %8.1f ns per call, %6.2f ns per frame%s\n", frames,
+		        time, time / frames,
+		        frames == 1 && time > kTargetNanoseconds ? " (above the 100 ns target)" : "");
+	}
+}
+
+//------------------------------------------------------------------------
+// Convolution: the ConvolutionStage against the direct convolution (the reference of
+// againconvolutiontest.cpp) on 64 channels in blocks of 256 frames, per channel and frame. An
+// impulse response of kConvolutionPartition frames is the time domain head alone (128
+// multiply-adds per frame), each further partition adds one spectrum multiply-add per partition.
+//------------------------------------------------------------------------
+static std::vector<uint8> makeImpulseResponse (int32 numFrames)
+{
+	ImpulseResponseHeader header {kImpulseResponseMagic, 1, numFrames, 48000.f};
+	std::vector<uint8> payload (sizeof (header) + sizeof (float) * numFrames);
+	memcpy (payload.data (), &header, sizeof (header));
+	std::mt19937 random (numFrames);
+	std::uniform_real_distribution<float> noise (-1.f, 1.f);
+	for (int32 i = 0; i < numFrames; i++)
+	{
+		float sample = noise (random) * std::exp (-4.f * i / numFrames);
+		memcpy (payload.data () + sizeof (header) + sizeof (float) * i, &sample, sizeof (float));
+	}
+	return payload;
+}
+
+static void benchmarkConvolution ()
+{
+	constexpr int32 kChannels = 64;
+	constexpr int32 kBlockFrames = 256;
+	constexpr int32 kBlocks = 400;
+
+	std::vector<float> input ((size_t)kChannels * kBlockFrames);
+	std::mt19937 random (1);
+	std::uniform_real_distribution<float> noise (-1.f, 1.f);
+	for (float& sample : input)
+		sample = noise (random);
+
+	for (int32 irFrames : {kConvolutionPartition, 1024, 8192, 65536})
+	{
+		std::vector<uint8> payload = makeImpulseResponse (irFrames);
+		std::vector<float> ir (irFrames);
+		memcpy (ir.data (), payload.data () + sizeof (ImpulseResponseHeader),
+		        sizeof (float) * irFrames);
+
+		ConvolutionKernelSlot slot;
+		slot.setNumChannels (kChannels);
+		slot.publish (slot.prepare (ImpulseResponsePayload::adopt (std::move (payload))));
+		ProcessArena arena;
+		ConvolutionStage stage;
+		arena.beginMeasure ();
+		stage.setup (arena, kChannels);
+		arena.commit (false);
+		stage.setup (arena, kChannels);
+
+		std::vector<float> buffer (input.size ());
+		float* channels[kChannels];
+		for (int32 c = 0; c < kChannels; c++)
+			channels[c] = buffer.data () + (size_t)c * kBlockFrames;
+		auto start = Clock::now ();
+		for (int32 b = 0; b < kBlocks; b++)
+		{
+			buffer = input;
+			stage.process<float> (slot, channels, kChannels, kBlockFrames);
+		}
+		double stageTime = elapsedMicroseconds (start) * 1000. / kBlocks;
+
+		// direct form over a history of the last irFrames - 1 input frames of each channel, as
+		// many blocks as needed for a stable time
+		int32 directBlocks = std::max (2, kBlocks * kConvolutionPartition / irFrames);
+		std::vector<float> history ((size_t)kChannels * (irFrames - 1 + kBlockFrames), 0.f);
+		double checksum = 0.; // keeps the results alive
+		start = Clock::now ();
+		for (int32 b = 0; b < directBlocks; b++)
+		{
+			for (int32 c = 0; c < kChannels; c++)
+			{
+				float* x = history.data () + (size_t)c * (irFrames - 1 + kBlockFrames);
+				memmove (x, x + kBlockFrames, sizeof (float) * (irFrames - 1));
+				memcpy (x + irFrames - 1, input.data () + (size_t)c * kBlockFrames,
+				        sizeof (float) * kBlockFrames);
+				for (int32 n = 0; n < kBlockFrames; n++)
+				{
+					float sum = 0.f;
+					for (int32 j = 0; j < irFrames; j++)
+						sum += ir[j] * x[irFrames - 1 + n - j];
+					checksum += sum;
+				}
+			}
+		}
+		double directTime = elapsedMicroseconds (start) * 1000. / directBlocks;
+		volatile double sink = checksum;
+		(void)sink;
+
+		const double perFrame = 1. / ((double)kChannels * kBlockFrames);
+		printf ("convolution    %5d frames IR: %8.2f ns per channel and frame, direct %9.2f\n",
+		        irFrames, stageTime * perFrame, directTime * perFrame);
+		stage.reset (slot);
+		slot.clear ();
+	}
+}
+
+//------------------------------------------------------------------------
+// Float compute: the kSample64 pipelines against their kPipelineFloatCompute versions (the
+// candidates of the autotuner with AGAIN_FLOAT_COMPUTE=1) per block of 512 frames, and the largest
+// relative error of a sample and of the peak against double precision, on input spanning 60 dB
+// with both signs.
+//------------------------------------------------------------------------
+static void benchmarkFloatCompute ()
+{
+	constexpr int32 kFrames = 512;
+	constexpr int32 kBlocks = 20000;
+
+	for (int32 numChannels : {2, 64})
+	{
+		std::vector<Sample64> input ((size_t)numChannels * kFrames);
+		std::mt19937 random (numChannels);
+		std::uniform_real_distribution<double> decibels (-60., 0.);
+		for (Sample64& sample : input)
+			sample = (random () & 1 ? 1. : -1.) * std::pow (10., decibels (random) / 20.);
+		std::vector<float> frameGains (kFrames);
+		for (int32 n = 0; n < kFrames; n++)
+			frameGains[n] = 0.25f + 0.5f * n / kFrames;
+		std::vector<Sample64> doubleOutput (input.size ()), floatOutput (input.size ());
+		Sample64* in[64];
+		Sample64* doubleOut[64];
+		Sample64* floatOut[64];
+		for (int32 c = 0; c < numChannels; c++)
+		{
+			in[c] = input.data () + (size_t)c * kFrames;
+			doubleOut[c] = doubleOutput.data () + (size_t)c * kFrames;
+			floatOut[c] = floatOutput.data () + (size_t)c * kFrames;
+		}
+		PipelineContext context;
+		context.gain = 0.7f;
+		context.gains = frameGains.data ();
+
+		for (int32 v = 0; v < kNumKernelVariants; v++)
+		{
+			KernelVariant variant = (KernelVariant)v;
+			if (!isKernelVariantSupported (variant))
+				continue;
+			for (uint32 flags : {0u, (uint32)kPipelineFrameGains,
+			                     (uint32)(kPipelineSanitize | kPipelineAbsoluteMeter)})
+			{
+				auto measure = [&] (PipelineFunction<Sample64> function, Sample64** out,
+				                    Sample64& peak) {
+					auto start = Clock::now ();
+					for (int32 b = 0; b < kBlocks; b++)
+						peak = function (in, out, numChannels, kFrames, kFrames, context);
+					return elapsedMicroseconds (start) * 1000. / kBlocks;
+				};
+				Sample64 doublePeak = 0., floatPeak = 0.;
+				uint32 floatFlags = flags | kPipelineFloatCompute;
+				double doubleTime =
+				    measure (getPipeline<Sample64> (flags, variant), doubleOut, doublePeak);
+				double floatTime =
+				    measure (getPipeline<Sample64> (floatFlags, variant), floatOut, floatPeak);
+
+				double maxError = 0.;
+				for (size_t i = 0; i < input.size (); i++)
+					maxError = std::max (maxError, std::abs (floatOutput[i] - doubleOutput[i]) /
+					                                   std::abs (doubleOutput[i]));
+				double peakError = std::abs (floatPeak - doublePeak) / doublePeak;
+				printf ("float compute  %2d channels %-6s flags %2u: double %7.1f ns, float %7.1f "
+				        "ns per block, error %.1e (peak %.1e)\n",
+				        numChannels, getKernelVariantName (variant), flags, doubleTime, floatTime,
+				        maxError, peakError);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+// Performance counters: the hardware counters of process calls from 32 to 4096 frames (see
+// againperfcounters.h), reported per kernel variant and block size when the processor is
+// deactivated. Linux only, perf_event_paranoid has to allow counting in user space.
+//------------------------------------------------------------------------
+static void benchmarkPerfCounters (HostApplication& host)
+{
+#if AGAIN_PERF_COUNTERS
+	// read by setupProcessing
+	setenv ("AGAIN_PERF_COUNTERS", "1", 1);
+	{
+		BenchmarkProcessor processor (host, 4096);
+		for (int32 frames = 32; frames <= 4096; frames *= 2)
+		{
+			double time = processor.process (frames, 20000);
+			printf ("perf counters  %5d frames:    %8.1f ns per call, %6.2f ns per frame\n",
+			        frames, time, time / frames);
+		}
+		fflush (stdout);
+	}
+	unsetenv ("AGAIN_PERF_COUNTERS");
+#else
+	(void)host;
+	printf ("perf counters  not available on this platform\n");
+#endif
+}
+
+//------------------------------------------------------------------------
+// usage: againbenchmark
+// Prints one line per measurement, the performance counter report of the processor follows on
+// stderr. Build it with the same options as the plugin.
+//------------------------------------------------------------------------
+int main ()
+{
+	HostApplication host;
+	for (int32 numInstances : {1, 100, 1000})
+		benchmarkInstantiation (host, numInstances);
+	benchmarkSmallBlocks (host);
+	benchmarkConvolution ();
+	benchmarkFloatCompute ();
+	benchmarkPerfCounters (host);
+	return 0;
+}
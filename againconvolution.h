@@ -0,0 +1,812 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againconvolution.h
+// Description : Zero latency partitioned FFT convolution after the AGain gain stage
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againarena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// The impulse response is cut into partitions of kConvolutionPartition frames:
+// - the first partition (head) is applied directly in the time domain: no latency
+// - all other ones (tail) are applied in the frequency domain (uniformly partitioned overlap-save
+//   with a frequency domain delay line), their spectra are computed once when the IR is loaded
+// The partition length trades the head (128 multiply-adds per frame and channel, about 28 ns on
+// SSE2) against the number of tail partitions: 64 frames save a third of the head but double the
+// tail cost of room sized IRs (see benchmarkConvolution in againbenchmark.cpp).
+//------------------------------------------------------------------------
+static constexpr int32 kConvolutionPartition = 128;
+static constexpr int32 kConvolutionFFTSize = 2 * kConvolutionPartition;
+static constexpr int32 kConvolutionBins = kConvolutionFFTSize / 2 + 1;
+static constexpr int32 kConvolutionBinStride = (kConvolutionBins + 15) & ~15; // cache line multiple
+static constexpr int32 kMaxImpulseFrames = 1 << 16;
+static constexpr int32 kMaxImpulseChannels = 64;
+
+//------------------------------------------------------------------------
+// "MyData" payload of the "BinaryMessage" (or content of a shared memory region): this header
+// followed by numChannels * numFrames float samples, one channel after the other. numFrames == 0
+// unloads the impulse response. The processor channel i uses the IR channel i % numChannels.
+// Payloads larger than kMaxImpulseResponseSize are rejected (frames and channels beyond the
+// maximum of smaller ones are ignored).
+//------------------------------------------------------------------------
+static constexpr uint32 kImpulseResponseMagic = 0x52494741; // 'AGIR'
+
+struct ImpulseResponseHeader
+{
+	uint32 magic;
+	int32 numChannels;
+	int32 numFrames;
+	float sampleRate; // informative, the IR is used as is
+};
+
+static constexpr int32 kMaxImpulseResponseSize =
+    (int32)sizeof (ImpulseResponseHeader) +
+    kMaxImpulseFrames * kMaxImpulseChannels * (int32)sizeof (float);
+
+//------------------------------------------------------------------------
+// ImpulseResponsePayload: the payload a kernel is created from and keeps referencing (written
+// with the processor state). owner keeps data alive: the mapped shared memory region it was sent
+// in (nothing is copied) or the buffer it was read into.
+//------------------------------------------------------------------------
+struct ImpulseResponsePayload
+{
+	std::shared_ptr<const void> owner;
+	const void* data {nullptr};
+	uint32 size {0};
+
+	// a buffer read from a stream
+	static ImpulseResponsePayload adopt (std::vector<uint8>&& buffer)
+	{
+		auto owned = std::make_shared<std::vector<uint8>> (std::move (buffer));
+		return {owned, owned->data (), (uint32)owned->size ()};
+	}
+
+	// data only valid during the call ("BinaryMessage": the host owns the message)
+	static ImpulseResponsePayload copy (const void* data, uint32 size)
+	{
+		const uint8* bytes = static_cast<const uint8*> (data);
+		return adopt (std::vector<uint8> (bytes, bytes + size));
+	}
+};
+
+//------------------------------------------------------------------------
+// RealFFT: real FFT of kConvolutionFFTSize samples, computed as a complex FFT of half the size
+// (split real/imaginary arrays, so the butterflies are plain vectorizable loops).
+// inverse (forward (x)) == kConvolutionFFTSize / 2 * x
+//------------------------------------------------------------------------
+class RealFFT
+{
+public:
+	static constexpr int32 kSize = kConvolutionFFTSize;
+	static constexpr int32 kHalf = kSize / 2;
+
+	RealFFT ()
+	{
+		const double pi = 3.14159265358979323846;
+		int32 bits = 0;
+		while ((1 << bits) < kHalf)
+			bits++;
+		for (int32 i = 0; i < kHalf; i++)
+		{
+			int32 r = 0;
+			for (int32 b = 0; b < bits; b++)
+				r |= ((i >> b) & 1) << (bits - 1 - b);
+			bitReverse[i] = r;
+		}
+		// twiddles of the stage with half size h are at [h, 2h)
+		for (int32 h = 1; h < kHalf; h *= 2)
+		{
+			for (int32 j = 0; j < h; j++)
+			{
+				twiddleRe[h + j] = (float)cos (-pi * j / h);
+				twiddleIm[h + j] = (float)sin (-pi * j / h);
+			}
+		}
+		for (int32 k = 0; k <= kHalf; k++)
+		{
+			splitRe[k] = (float)cos (-2. * pi * k / kSize);
+			splitIm[k] = (float)sin (-2. * pi * k / kSize);
+		}
+	}
+
+	// in: kSize samples, out: kHalf + 1 bins
+	void forward (const float* in, float* outRe, float* outIm)
+	{
+		for (int32 i = 0; i < kHalf; i++)
+		{
+			int32 r = bitReverse[i];
+			zRe[i] = in[2 * r];
+			zIm[i] = in[2 * r + 1];
+		}
+		transform (zRe, zIm, 1.f);
+
+		// separate the spectra of the even and odd samples and combine them
+		outRe[0] = zRe[0] + zIm[0];
+		outIm[0] = 0.f;
+		outRe[kHalf] = zRe[0] - zIm[0];
+		outIm[kHalf] = 0.f;
+		for (int32 k = 1; k < kHalf; k++)
+		{
+			float aRe = zRe[k], aIm = zIm[k];
+			float bRe = zRe[kHalf - k], bIm = -zIm[kHalf - k]; // conj (Z[M - k])
+			float eRe = 0.5f * (aRe + bRe), eIm = 0.5f * (aIm + bIm);
+			// o = -i/2 * (a - b)
+			float oRe = 0.5f * (aIm - bIm), oIm = -0.5f * (aRe - bRe);
+			outRe[k] = eRe + splitRe[k] * oRe - splitIm[k] * oIm;
+			outIm[k] = eIm + splitRe[k] * oIm + splitIm[k] * oRe;
+		}
+	}
+
+	// in: kHalf + 1 bins, out: kSize samples (not normalized, see above)
+	void inverse (const float* inRe, const float* inIm, float* out)
+	{
+		for (int32 k = 0; k < kHalf; k++)
+		{
+			float aRe = inRe[k], aIm = inIm[k];
+			float bRe = inRe[kHalf - k], bIm = -inIm[kHalf - k]; // conj (X[M - k])
+			float eRe = aRe + bRe, eIm = aIm + bIm;
+			// o = conj (W^k) * (a - b)
+			float dRe = aRe - bRe, dIm = aIm - bIm;
+			float oRe = splitRe[k] * dRe + splitIm[k] * dIm;
+			float oIm = splitRe[k] * dIm - splitIm[k] * dRe;
+			// z = e + i * o, written bit reversed for the transform
+			int32 r = bitReverse[k];
+			zRe[r] = 0.5f * (eRe - oIm);
+			zIm[r] = 0.5f * (eIm + oRe);
+		}
+		transform (zRe, zIm, -1.f);
+		for (int32 i = 0; i < kHalf; i++)
+		{
+			out[2 * i] = zRe[i];
+			out[2 * i + 1] = zIm[i];
+		}
+	}
+
+//------------------------------------------------------------------------
+private:
+	// in place radix 2 decimation in time, input in bit reversed order. sign -1 is the inverse.
+	void transform (float* re, float* im, float sign)
+	{
+		for (int32 h = 1; h < kHalf; h *= 2)
+		{
+			const float* wRe = twiddleRe + h;
+			const float* wIm = twiddleIm + h;
+			for (int32 base = 0; base < kHalf; base += 2 * h)
+			{
+				float* aRe = re + base;
+				float* aIm = im + base;
+				float* bRe = aRe + h;
+				float* bIm = aIm + h;
+				for (int32 j = 0; j < h; j++)
+				{
+					float tRe = wRe[j] * bRe[j] - sign * wIm[j] * bIm[j];
+					float tIm = wRe[j] * bIm[j] + sign * wIm[j] * bRe[j];
+					bRe[j] = aRe[j] - tRe;
+					bIm[j] = aIm[j] - tIm;
+					aRe[j] += tRe;
+					aIm[j] += tIm;
+				}
+			}
+		}
+	}
+
+	int32 bitReverse[kHalf];
+	float twiddleRe[kHalf];
+	float twiddleIm[kHalf];
+	float splitRe[kHalf + 1];
+	float splitIm[kHalf + 1];
+	float zRe[kHalf];
+	float zIm[kHalf];
+};
+
+//------------------------------------------------------------------------
+// ConvolutionKernel: a fully prepared impulse response. Created outside the audio thread, handed
+// over with a ConvolutionKernelSlot. The partition spectra are immutable; the kernel also owns the
+// frequency domain delay line of the processor input its tail needs (numInputChannels channels,
+// one entry per tail partition), so its memory follows the loaded IR and an instance without IR
+// carries none. Only the audio thread writes that delay line, while it uses the kernel.
+//------------------------------------------------------------------------
+class ConvolutionKernel
+{
+public:
+	// returns nullptr if the payload is not a valid impulse response (or an empty one)
+	static ConvolutionKernel* create (const ImpulseResponsePayload& payload,
+	                                  int32 numInputChannels)
+	{
+		if (!isImpulseResponse (payload.data, payload.size))
+			return nullptr;
+		ImpulseResponseHeader header;
+		memcpy (&header, payload.data, sizeof (header));
+		if (header.numFrames == 0)
+			return nullptr;
+
+		const float* samples = reinterpret_cast<const float*> (
+		    static_cast<const uint8*> (payload.data) + sizeof (ImpulseResponseHeader));
+		int32 numFrames = std::min (header.numFrames, kMaxImpulseFrames);
+		int32 numChannels = std::min (header.numChannels, kMaxImpulseChannels);
+
+		auto* kernel = new ConvolutionKernel;
+		kernel->payload = payload;
+		kernel->numChannels = numChannels;
+		kernel->numPartitions =
+		    (std::max (numFrames - kConvolutionPartition, 0) + kConvolutionPartition - 1) /
+		    kConvolutionPartition;
+		kernel->head.assign (numChannels * kConvolutionPartition, 0.f);
+		kernel->spectra.assign (
+		    (size_t)numChannels * kernel->numPartitions * 2 * kConvolutionBinStride, 0.f);
+		kernel->numInputChannels = std::max (numInputChannels, 1);
+		kernel->inputSpectra.assign ((size_t)kernel->numInputChannels * kernel->numPartitions * 2 *
+		                                 kConvolutionBinStride,
+		                             0.f);
+
+		RealFFT fft;
+		float segment[kConvolutionFFTSize];
+		// the inverse transform is not normalized, the kernel takes that factor
+		const float scale = 1.f / (float)RealFFT::kHalf;
+		for (int32 c = 0; c < numChannels; c++)
+		{
+			float ir[kConvolutionPartition];
+			const float* channel = samples + (size_t)c * header.numFrames;
+
+			// head reversed: the direct form is then a forward running dot product
+			for (int32 j = 0; j < std::min (numFrames, kConvolutionPartition); j++)
+				kernel->head[c * kConvolutionPartition + kConvolutionPartition - 1 - j] =
+				    readSample (channel + j);
+
+			for (int32 p = 0; p < kernel->numPartitions; p++)
+			{
+				int32 start = (p + 1) * kConvolutionPartition;
+				int32 count = std::min (kConvolutionPartition, numFrames - start);
+				for (int32 j = 0; j < kConvolutionPartition; j++)
+					ir[j] = j < count ? readSample (channel + start + j) * scale : 0.f;
+				std::copy (ir, ir + kConvolutionPartition, segment);
+				std::fill (segment + kConvolutionPartition, segment + kConvolutionFFTSize, 0.f);
+				float* re = kernel->getSpectrum (c, p);
+				fft.forward (segment, re, re + kConvolutionBinStride);
+			}
+		}
+		return kernel;
+	}
+
+	static bool isImpulseResponse (const void* data, uint32 size)
+	{
+		if (!data || size < sizeof (ImpulseResponseHeader) || size > kMaxImpulseResponseSize)
+			return false;
+		ImpulseResponseHeader header;
+		memcpy (&header, data, sizeof (header));
+		if (header.magic != kImpulseResponseMagic || header.numChannels < 1 ||
+		    header.numFrames < 0)
+			return false;
+		uint64 expected = sizeof (ImpulseResponseHeader) +
+		                  (uint64)header.numChannels * (uint64)header.numFrames * sizeof (float);
+		return size >= expected;
+	}
+
+	int32 getNumChannels () const { return numChannels; }
+	int32 getNumPartitions () const { return numPartitions; }
+	const float* getHead (int32 channel) const
+	{
+		return head.data () + (channel % numChannels) * kConvolutionPartition;
+	}
+	// real part followed (kConvolutionBinStride later) by the imaginary part
+	const float* getSpectrum (int32 channel, int32 partition) const
+	{
+		return spectra.data () +
+		       ((size_t)(channel % numChannels) * numPartitions + partition) * 2 *
+		           kConvolutionBinStride;
+	}
+
+	uint64 getSequence () const { return sequence; }
+
+	// the payload this kernel was created from (stored with the processor state)
+	const ImpulseResponsePayload& getPayload () const { return payload; }
+
+	//--- audio thread: delay line of the input spectra (index 0 is the newest) ---
+	int32 getNumInputChannels () const { return numInputChannels; }
+	int32 getNumValidInputs () const { return numValidInputs; }
+	void clearInputs () const
+	{
+		inputPosition = 0;
+		numValidInputs = 0;
+	}
+	// makes room for the newest spectrum of every channel (entry 0)
+	void advanceInputs () const
+	{
+		if (numPartitions == 0)
+			return;
+		inputPosition = (inputPosition + numPartitions - 1) % numPartitions;
+		numValidInputs = std::min (numValidInputs + 1, numPartitions);
+	}
+	// real part followed (kConvolutionBinStride later) by the imaginary part
+	float* getInputSpectrum (int32 channel, int32 index) const
+	{
+		return const_cast<float*> (inputSpectra.data ()) +
+		       ((size_t)channel * numPartitions + (inputPosition + index) % numPartitions) * 2 *
+		           kConvolutionBinStride;
+	}
+
+//------------------------------------------------------------------------
+private:
+	friend class ConvolutionKernelSlot;
+
+	ConvolutionKernel () = default;
+
+	float* getSpectrum (int32 channel, int32 partition)
+	{
+		return const_cast<float*> (
+		    static_cast<const ConvolutionKernel*> (this)->getSpectrum (channel, partition));
+	}
+
+	// the payload of a message is not necessarily aligned for float
+	static float readSample (const float* ptr)
+	{
+		float value;
+		memcpy (&value, ptr, sizeof (float));
+		return value;
+	}
+
+	int32 numChannels {0};
+	int32 numPartitions {0};
+	int32 numInputChannels {0};
+	std::vector<float> head;
+	std::vector<float> spectra;
+	ImpulseResponsePayload payload;
+	uint64 sequence {0};
+
+	std::vector<float> inputSpectra; // written by the audio thread only
+	mutable int32 inputPosition {0};
+	mutable int32 numValidInputs {0};
+};
+
+//------------------------------------------------------------------------
+// ConvolutionKernelSlot: hands kernels over to the audio thread with an atomic pointer swap.
+// The audio thread keeps using the previous kernel while it crossfades, so it tells which kernels
+// it may still reference: every published kernel gets a sequence number and the audio thread
+// publishes the oldest sequence it can still use. Replaced kernels older
+// than that are deleted from a non realtime thread.
+//------------------------------------------------------------------------
+class ConvolutionKernelSlot
+{
+public:
+	~ConvolutionKernelSlot () { clear (); }
+
+	// non realtime threads (nullptr unloads)
+	void publish (ConvolutionKernel* kernel)
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		publishLocked (kernel);
+	}
+
+	// non realtime threads: a kernel for the payload of a message or state, prepared for the
+	// current number of processor channels
+	ConvolutionKernel* prepare (const ImpulseResponsePayload& payload) const
+	{
+		return ConvolutionKernel::create (payload, numChannels.load ());
+	}
+	int32 getNumChannels () const { return numChannels.load (); }
+
+	// setupProcessing (process can not be called): kernels are prepared for this number of
+	// channels from now on, the current one is prepared again if it has fewer
+	void setNumChannels (int32 channels)
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		numChannels.store (channels);
+		const ConvolutionKernel* kernel = current.load ();
+		if (kernel && kernel->getNumInputChannels () < channels)
+			publishLocked (ConvolutionKernel::create (kernel->getPayload (), channels));
+	}
+
+	// non realtime threads: audioThreadIdle is true when process can not be called (inactive)
+	void collect (bool audioThreadIdle)
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		collectLocked (audioThreadIdle);
+	}
+
+	// non realtime threads, only when process can not be called anymore
+	void clear ()
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		delete current.exchange (nullptr);
+		collectLocked (true);
+	}
+
+	// non realtime threads: func is called with the current kernel (can be nullptr), which can not
+	// be replaced meanwhile
+	template <typename Func>
+	void readCurrent (Func&& func)
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		func (static_cast<const ConvolutionKernel*> (current.load ()));
+	}
+
+	//--- audio thread ---
+	const ConvolutionKernel* acquire () const { return current.load (std::memory_order_acquire); }
+	// no kernel with a smaller sequence is referenced anymore
+	void release (uint64 oldestSequence)
+	{
+		oldestInUse.store (oldestSequence, std::memory_order_release);
+	}
+
+//------------------------------------------------------------------------
+private:
+	void publishLocked (ConvolutionKernel* kernel)
+	{
+		if (kernel)
+			kernel->sequence = ++sequence;
+		ConvolutionKernel* old = current.exchange (kernel);
+		if (old)
+			retired.push_back (old);
+		collectLocked (false);
+	}
+
+	void collectLocked (bool audioThreadIdle)
+	{
+		uint64 oldest = oldestInUse.load (std::memory_order_acquire);
+		for (auto it = retired.begin (); it != retired.end ();)
+		{
+			if (audioThreadIdle || (*it)->sequence < oldest)
+			{
+				delete *it;
+				it = retired.erase (it);
+			}
+			else
+				++it;
+		}
+	}
+
+	std::mutex writerMutex; // serializes the non realtime threads, never taken by the audio thread
+	std::atomic<ConvolutionKernel*> current {nullptr};
+	std::atomic<uint64> oldestInUse {0};
+	std::atomic<int32> numChannels {2};
+	uint64 sequence {0};
+	std::vector<ConvolutionKernel*> retired;
+};
+
+//------------------------------------------------------------------------
+// ConvolutionStage: applies the kernel of a ConvolutionKernelSlot in place on all channels.
+// A new kernel is picked up at a partition boundary and crossfaded over one partition (from the
+// dry signal when nothing was loaded before). The per channel state lives in the ProcessArena
+// (about 3 KB per channel), the delay line of the tail in the kernel.
+//
+// Load: the head runs per sample. The spectral sums of the tail over the older partitions only
+// depend on spectra which are already known, they are accumulated in steps spread over the frames
+// of the partition. The boundary itself only carries the forward and inverse FFT of each channel
+// and the sum of the newest partition.
+//------------------------------------------------------------------------
+class ConvolutionStage
+{
+public:
+	void setup (ProcessArena& arena, int32 channels)
+	{
+		numChannels = channels;
+		timeBuffers = arena.allocate<float> ((size_t)numChannels * kConvolutionFFTSize);
+		tails = arena.allocate<float> ((size_t)numChannels * kConvolutionPartition);
+		fadeTails = arena.allocate<float> ((size_t)numChannels * kConvolutionPartition);
+		accumulators = arena.allocate<float> ((size_t)numChannels * 2 * kConvolutionBinStride);
+		active = nullptr;
+		fading = false;
+		fadeFrom = nullptr;
+	}
+
+	// no kernel is referenced anymore: called when the audio thread becomes idle (setActive) before
+	// replaced kernels are deleted, and by the audio thread when the stage is bypassed. The next
+	// process restarts from silence with the current kernel.
+	void reset (ConvolutionKernelSlot& slot)
+	{
+		active = nullptr;
+		fadeFrom = nullptr;
+		previous = nullptr;
+		fading = false;
+		releaseUnused (slot);
+	}
+
+	// true while a kernel is (or was, until the fade out ended) applied: the output is not silent
+	// even for a silent input then
+	bool isActive (const ConvolutionKernelSlot& slot) const
+	{
+		return timeBuffers && (active || fading || slot.acquire ());
+	}
+
+	template <typename SampleType>
+	void process (ConvolutionKernelSlot& slot, SampleType** buffers, int32 channels,
+	              int32 sampleFrames)
+	{
+		if (!timeBuffers)
+			return;
+		if (!active && !fading)
+		{
+			const ConvolutionKernel* next = slot.acquire ();
+			if (!next)
+				return;
+			restart ();
+			startFade (slot, next);
+		}
+
+		channels = std::min (channels, numChannels);
+		int32 done = 0;
+		while (done < sampleFrames)
+		{
+			int32 count = std::min (sampleFrames - done, kConvolutionPartition - position);
+			for (int32 c = 0; c < channels; c++)
+				processSegment (buffers[c] + done, c, count);
+			position += count;
+			done += count;
+			if (position == kConvolutionPartition)
+				nextPartition (slot, channels);
+			else
+				accumulateOlderPartitions (channels, position);
+		}
+	}
+
+//------------------------------------------------------------------------
+private:
+	void restart ()
+	{
+		position = 0;
+		memset (timeBuffers, 0, (size_t)numChannels * kConvolutionFFTSize * sizeof (float));
+		memset (tails, 0, (size_t)numChannels * kConvolutionPartition * sizeof (float));
+		memset (fadeTails, 0, (size_t)numChannels * kConvolutionPartition * sizeof (float));
+		clearAccumulators ();
+	}
+
+	void startFade (ConvolutionKernelSlot& slot, const ConvolutionKernel* next)
+	{
+		fadeFrom = active;
+		fading = true;
+		// the new kernel starts with an empty delay line, its older entries are read from the
+		// delay line of the old kernel until it is filled. That one only reaches back as far as
+		// the old impulse response (and only its own entries if it still borrowed as well).
+		previous = next ? active : nullptr;
+		numOwnInputs = 0;
+		active = next;
+		if (next)
+		{
+			next->clearInputs ();
+			lastSequence = next->getSequence ();
+		}
+		releaseUnused (slot);
+	}
+
+	// the oldest kernel still referenced, or (nothing referenced) anything not seen yet
+	void releaseUnused (ConvolutionKernelSlot& slot)
+	{
+		uint64 oldest = lastSequence + 1;
+		if (active)
+			oldest = std::min (oldest, active->getSequence ());
+		if (fadeFrom)
+			oldest = std::min (oldest, fadeFrom->getSequence ());
+		if (previous)
+			oldest = std::min (oldest, previous->getSequence ());
+		slot.release (oldest);
+	}
+
+	// history: [previous partition | current partition], the new samples go to position
+	template <typename SampleType>
+	void processSegment (SampleType* buffer, int32 channel, int32 count)
+	{
+		float* history = timeBuffers + (size_t)channel * kConvolutionFFTSize;
+		const float* tail = tails + channel * kConvolutionPartition;
+		const float* fadeTail = fadeTails + channel * kConvolutionPartition;
+		for (int32 n = 0; n < count; n++)
+		{
+			int32 pos = position + n;
+			float dry = (float)buffer[n];
+			history[kConvolutionPartition + pos] = dry;
+
+			// samples [pos + 1, pos + kConvolutionPartition] against the reversed head
+			const float* x = history + pos + 1;
+			float wet = active ? convolveHead (active->getHead (channel), x) + tail[pos] : dry;
+			if (fading)
+			{
+				float old =
+				    fadeFrom ? convolveHead (fadeFrom->getHead (channel), x) + fadeTail[pos] : dry;
+				float amount = (float)(pos + 1) / (float)kConvolutionPartition;
+				wet = old + amount * (wet - old);
+			}
+			buffer[n] = (SampleType)wet;
+		}
+	}
+
+	static float convolveHead (const float* head, const float* x)
+	{
+		constexpr int32 L = 8;
+		float acc[L] = {};
+		for (int32 j = 0; j < kConvolutionPartition; j += L)
+		{
+			for (int32 l = 0; l < L; l++)
+				acc[l] += head[j + l] * x[j + l];
+		}
+		float sum = 0.f;
+		for (int32 l = 0; l < L; l++)
+			sum += acc[l];
+		return sum;
+	}
+
+	// the part of the next tail of the active kernel that is known before the boundary: its
+	// partitions 1.. against the input spectra up to now, in steps proportional to pos
+	void accumulateOlderPartitions (int32 channels, int32 pos)
+	{
+		if (!active)
+			return;
+		// after the boundary the current entry i of the delay line is entry i + 1
+		int32 numOlder = std::min (active->getNumPartitions () - 1, getNumValidInputs ());
+		int32 target = (numOlder * pos + kConvolutionPartition - 1) / kConvolutionPartition;
+		for (; numAccumulated < target; numAccumulated++)
+		{
+			for (int32 c = 0; c < channels; c++)
+				multiplyAccumulate (active, c, getInput (c, numAccumulated), numAccumulated + 1);
+		}
+	}
+
+	// delay line of the active kernel, continued by the one of the kernel before the switch
+	int32 getNumValidInputs () const
+	{
+		if (!previous)
+			return active->getNumValidInputs ();
+		return numOwnInputs + std::max (previous->getNumValidInputs () - 1, 0);
+	}
+
+	const float* getInput (int32 channel, int32 index) const
+	{
+		if (!previous || index < numOwnInputs)
+			return channel < active->getNumInputChannels () ?
+			           active->getInputSpectrum (channel, index) :
+			           nullptr;
+		// both delay lines got the spectrum of the switch, the one of the old kernel stopped there
+		return channel < previous->getNumInputChannels () ?
+		           previous->getInputSpectrum (channel, index - numOwnInputs + 1) :
+		           nullptr;
+	}
+
+	void nextPartition (ConvolutionKernelSlot& slot, int32 channels)
+	{
+		position = 0;
+		accumulateOlderPartitions (channels, kConvolutionPartition);
+
+		// the previous fade is complete
+		if (fading)
+		{
+			fading = false;
+			fadeFrom = nullptr;
+			releaseUnused (slot);
+		}
+		// a new kernel: the sums accumulated for the old one are its fade out tail
+		const ConvolutionKernel* next = slot.acquire ();
+		bool switching = next != active;
+		if (switching)
+			startFade (slot, next);
+
+		// spectrum of [previous | current] becomes the newest entry of the delay lines
+		if (active)
+		{
+			active->advanceInputs ();
+			if (previous && ++numOwnInputs >= active->getNumPartitions ())
+			{
+				previous = nullptr;
+				releaseUnused (slot);
+			}
+		}
+		if (fadeFrom)
+			fadeFrom->advanceInputs ();
+		for (int32 c = 0; c < channels; c++)
+		{
+			float* history = timeBuffers + (size_t)c * kConvolutionFFTSize;
+			float* spectrum = nullptr;
+			for (const ConvolutionKernel* kernel : {active, fadeFrom})
+			{
+				if (!kernel || kernel->getNumPartitions () == 0 ||
+				    c >= kernel->getNumInputChannels ())
+					continue;
+				float* entry = kernel->getInputSpectrum (c, 0);
+				if (spectrum)
+					memcpy (entry, spectrum, 2 * kConvolutionBinStride * sizeof (float));
+				else
+					fft.forward (history, entry, entry + kConvolutionBinStride);
+				spectrum = entry;
+			}
+			memcpy (history, history + kConvolutionPartition,
+			        kConvolutionPartition * sizeof (float));
+		}
+
+		for (int32 c = 0; c < channels; c++)
+		{
+			if (switching)
+			{
+				// the old kernel gets the newest partition on top of its accumulated sums, the
+				// new one starts from the newest partition alone
+				if (fadeFrom)
+					finishTail (fadeFrom, c, fadeTails + c * kConvolutionPartition);
+				clearAccumulator (c);
+			}
+			if (active)
+				finishTail (active, c, tails + c * kConvolutionPartition);
+			clearAccumulator (c);
+		}
+		numAccumulated = 0;
+	}
+
+	// an input spectrum against a tail partition of the kernel, into the accumulator of channel
+	void multiplyAccumulate (const ConvolutionKernel* kernel, int32 channel, const float* xRe,
+	                         int32 partition)
+	{
+		if (!xRe)
+			return;
+		constexpr int32 S = kConvolutionBinStride;
+		float* accRe = accumulators + (size_t)channel * 2 * S;
+		float* accIm = accRe + S;
+		const float* xIm = xRe + S;
+		const float* hRe = kernel->getSpectrum (channel, partition);
+		const float* hIm = hRe + S;
+		for (int32 k = 0; k < S; k++)
+		{
+			accRe[k] += xRe[k] * hRe[k] - xIm[k] * hIm[k];
+			accIm[k] += xRe[k] * hIm[k] + xIm[k] * hRe[k];
+		}
+	}
+
+	// newest partition on top of the accumulated ones, back into the time domain
+	void finishTail (const ConvolutionKernel* kernel, int32 channel, float* tail)
+	{
+		if (kernel->getNumPartitions () == 0 || channel >= kernel->getNumInputChannels ())
+		{
+			memset (tail, 0, kConvolutionPartition * sizeof (float));
+			return;
+		}
+		multiplyAccumulate (kernel, channel, kernel->getInputSpectrum (channel, 0), 0);
+		float* accRe = accumulators + (size_t)channel * 2 * kConvolutionBinStride;
+		float block[kConvolutionFFTSize];
+		fft.inverse (accRe, accRe + kConvolutionBinStride, block);
+		// overlap-save: only the second half is free of circular aliasing
+		memcpy (tail, block + kConvolutionPartition, kConvolutionPartition * sizeof (float));
+	}
+
+	void clearAccumulator (int32 channel)
+	{
+		memset (accumulators + (size_t)channel * 2 * kConvolutionBinStride, 0,
+		        2 * kConvolutionBinStride * sizeof (float));
+	}
+
+	void clearAccumulators ()
+	{
+		memset (accumulators, 0, (size_t)numChannels * 2 * kConvolutionBinStride * sizeof (float));
+		numAccumulated = 0;
+	}
+
+	RealFFT fft;
+	float* timeBuffers {nullptr};
+	float* tails {nullptr};
+	float* fadeTails {nullptr};
+	float* accumulators {nullptr};
+	int32 numChannels {0};
+	int32 position {0};
+	int32 numAccumulated {0}; // older partitions of the active kernel summed up for the next tail
+
+	const ConvolutionKernel* active {nullptr};
+	const ConvolutionKernel* fadeFrom {nullptr};
+	const ConvolutionKernel* previous {nullptr}; // older input spectra of the active kernel
+	int32 numOwnInputs {0};
+	uint64 lastSequence {0};
+	bool fading {false};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
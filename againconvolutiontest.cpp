@@ -0,0 +1,156 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againconvolutiontest.cpp
+// Description : Compares the ConvolutionStage against a direct convolution
+//-----------------------------------------------------------------------------
+#include "againconvolution.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// For impulse responses of one sample, a partial partition and many partitions (two channels,
+// the second one different), the stage runs on noise in blocks of random sizes. Once its fade in
+// is over the output has to match the direct convolution. Then a second impulse response is
+// loaded while the signal keeps running: after the crossfade partition the output has to match
+// the direct convolution with the new one, including the reverb of the input before the switch
+// (a longer impulse response only gets as much of that input as the old one kept, so it is
+// checked once the input before the switch has left it).
+// Returns 0 when every check passed.
+//------------------------------------------------------------------------
+static constexpr int32 kNumChannels = 2;
+static constexpr float kTolerance = 1e-4f;
+
+//------------------------------------------------------------------------
+static std::vector<uint8> makeImpulseResponse (int32 numFrames, uint32 seed)
+{
+	ImpulseResponseHeader header;
+	header.magic = kImpulseResponseMagic;
+	header.numChannels = kNumChannels;
+	header.numFrames = numFrames;
+	header.sampleRate = 48000.f;
+	std::vector<uint8> payload (sizeof (header) + sizeof (float) * kNumChannels * numFrames);
+	memcpy (payload.data (), &header, sizeof (header));
+
+	std::mt19937 random (seed);
+	std::uniform_real_distribution<float> noise (-1.f, 1.f);
+	float* samples = reinterpret_cast<float*> (payload.data () + sizeof (header));
+	for (int32 c = 0; c < kNumChannels; c++)
+	{
+		// decaying noise, like a room
+		for (int32 i = 0; i < numFrames; i++)
+			samples[c * numFrames + i] = noise (random) * std::exp (-4.f * i / numFrames);
+	}
+	return payload;
+}
+
+//------------------------------------------------------------------------
+static float directConvolution (const std::vector<uint8>& payload, int32 channel,
+                                const std::vector<float>& input, int32 frame)
+{
+	ImpulseResponseHeader header;
+	memcpy (&header, payload.data (), sizeof (header));
+	const float* ir = reinterpret_cast<const float*> (payload.data () + sizeof (header)) +
+	                  channel * header.numFrames;
+	double sum = 0.;
+	for (int32 j = 0; j < header.numFrames && j <= frame; j++)
+		sum += (double)ir[j] * input[frame - j];
+	return (float)sum;
+}
+
+//------------------------------------------------------------------------
+static int32 runTest (int32 numFrames, int32 nextNumFrames, uint32 seed)
+{
+	std::vector<uint8> first = makeImpulseResponse (numFrames, seed);
+	std::vector<uint8> second = makeImpulseResponse (nextNumFrames, seed + 1);
+
+	ConvolutionKernelSlot slot;
+	slot.setNumChannels (kNumChannels);
+	auto load = [&] (const std::vector<uint8>& payload) {
+		slot.publish (
+		    slot.prepare (ImpulseResponsePayload::copy (payload.data (), (uint32)payload.size ())));
+	};
+	load (first);
+
+	ProcessArena arena;
+	ConvolutionStage stage;
+	arena.beginMeasure ();
+	stage.setup (arena, kNumChannels);
+	arena.commit (false);
+	stage.setup (arena, kNumChannels);
+
+	// the switch happens between these frames, in the first block after publishing
+	const int32 switchFrame = std::max (numFrames, 4 * kConvolutionPartition) + 1000;
+	const int32 totalFrames = switchFrame + nextNumFrames + 4 * kConvolutionPartition;
+	std::mt19937 random (seed);
+	std::uniform_real_distribution<float> noise (-1.f, 1.f);
+	std::uniform_int_distribution<int32> blockSize (1, 300);
+	std::vector<float> input[kNumChannels];
+	std::vector<float> output[kNumChannels];
+	for (int32 c = 0; c < kNumChannels; c++)
+	{
+		for (int32 i = 0; i < totalFrames; i++)
+			input[c].push_back (noise (random));
+		output[c] = input[c];
+	}
+
+	int32 switchedAt = -1;
+	for (int32 done = 0; done < totalFrames;)
+	{
+		int32 count = std::min (blockSize (random), totalFrames - done);
+		if (done >= switchFrame && switchedAt < 0)
+		{
+			load (second);
+			switchedAt = done;
+		}
+		float* buffers[kNumChannels] = {output[0].data () + done, output[1].data () + done};
+		stage.process<float> (slot, buffers, kNumChannels, count);
+		done += count;
+	}
+
+	// the fade in ends with the first partition, the crossfade at most two partitions after
+	// publishing (next boundary plus one partition)
+	int32 switchFrames = 2 * kConvolutionPartition;
+	if (nextNumFrames > numFrames)
+		switchFrames += nextNumFrames;
+	int32 failures = 0;
+	float maxError = 0.f;
+	for (int32 c = 0; c < kNumChannels; c++)
+	{
+		for (int32 i = kConvolutionPartition; i < totalFrames; i++)
+		{
+			if (i >= switchedAt && i < switchedAt + switchFrames)
+				continue;
+			const std::vector<uint8>& ir = i < switchedAt ? first : second;
+			float error = std::fabs (output[c][i] - directConvolution (ir, c, input[c], i));
+			maxError = std::max (maxError, error);
+			if (error > kTolerance * std::sqrt ((float)numFrames + nextNumFrames))
+				failures++;
+		}
+	}
+	fprintf (stderr, "[againconvolutiontest] %6d -> %6d frames: max error %g, %d failures\n",
+	         numFrames, nextNumFrames, maxError, failures);
+
+	stage.reset (slot);
+	slot.clear ();
+	return failures;
+}
+
+//------------------------------------------------------------------------
+int main ()
+{
+	int32 failures = 0;
+	failures += runTest (1, 1, 1);
+	failures += runTest (100, 300, 2);
+	failures += runTest (kConvolutionPartition, kConvolutionPartition + 1, 3);
+	failures += runTest (5000, 1500, 4);
+	failures += runTest (1500, 12000, 5);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againentry.cpp
+// Description : AGain Example for VST 3, plugin factory with AGain and its stem mode
+//-----------------------------------------------------------------------------
+#include "again.h"
+#include "againcids.h" // for class ids
+#include "againcontroller.h"
+#include "againstems.h"
+#include "againstemscids.h" // for class ids
+#include "version.h" // for versioning
+
+#include "public.sdk/source/main/pluginfactory.h"
+
+#define stringPluginName "AGain VST3"
+#define stringPluginStemsName "AGain Stems VST3"
+
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+//  Module init/exit
+//------------------------------------------------------------------------
+
+//------------------------------------------------------------------------
+// called after library was loaded
+bool InitModule ()
+{
+	return true;
+}
+
+//------------------------------------------------------------------------
+// called after library is unloaded
+bool DeinitModule ()
+{
+	return true;
+}
+
+//------------------------------------------------------------------------
+//  VST Plug-in Entry
+//------------------------------------------------------------------------
+BEGIN_FACTORY_DEF ("Steinberg Media Technologies",
+                   "http://www.steinberg.net",
+                   "mailto:info@steinberg.de")
+
+	//---First plug-in included in this factory-------
+	// its kVstAudioEffectClass component
+	DEF_CLASS2 (INLINE_UID_FROM_FUID (AGainProcessorUID),
+	            PClassInfo::kManyInstances, // cardinality
+	            kVstAudioEffectClass, // the component category (do not changed this)
+	            stringPluginName, // here the plug-in name (to be changed)
+	            Vst::kDistributable, // means that component and controller could be distributed on different computers
+	            "Fx", // Subcategory for this plug-in (to be changed)
+	            FULL_VERSION_STR, // Plug-in version (to be changed)
+	            kVstVersionString, // the VST 3 SDK version (do not changed this, use always this define)
+	            AGain::createInstance) // function pointer called when this component should be instantiated
+
+	// its kVstComponentControllerClass component
+	DEF_CLASS2 (INLINE_UID_FROM_FUID (AGainControllerUID),
+	            PClassInfo::kManyInstances, // cardinality
+	            kVstComponentControllerClass, // the Controller category (do not changed this)
+	            stringPluginName "Controller", // controller name (could be the same than component name)
+	            0, // not used here
+	            "", // not used here
+	            FULL_VERSION_STR, // Plug-in version (to be changed)
+	            kVstVersionString, // the VST 3 SDK version (do not changed this, use always this define)
+	            AGainController::createInstance) // function pointer called when this component should be instantiated
+
+	//---Second plug-in: the stem mode (AGAIN_STEM_BUSES busses, see againstems.h)-------
+	DEF_CLASS2 (INLINE_UID_FROM_FUID (AGainStemsProcessorUID),
+	            PClassInfo::kManyInstances,
+	            kVstAudioEffectClass,
+	            stringPluginStemsName,
+	            Vst::kDistributable,
+	            "Fx",
+	            FULL_VERSION_STR,
+	            kVstVersionString,
+	            AGainStems::createInstance)
+
+	DEF_CLASS2 (INLINE_UID_FROM_FUID (AGainStemsControllerUID),
+	            PClassInfo::kManyInstances,
+	            kVstComponentControllerClass,
+	            stringPluginStemsName "Controller",
+	            0,
+	            "",
+	            FULL_VERSION_STR,
+	            kVstVersionString,
+	            AGainStemsController::createInstance)
+
+	//----for others plug-ins contained in this factory, put like for the first plug-in different DEF_CLASS2---
+
+END_FACTORY
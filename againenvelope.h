@@ -0,0 +1,119 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againenvelope.h
+// Description : Sidechain envelope follower driving the AGain gain reduction
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againarena.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Parameter ranges (plain values), the normalized parameters map linearly into them
+static constexpr double kSidechainAttackMinMs = 0.1;
+static constexpr double kSidechainAttackMaxMs = 100.;
+static constexpr double kSidechainAttackDefaultMs = 10.;
+static constexpr double kSidechainReleaseMinMs = 10.;
+static constexpr double kSidechainReleaseMaxMs = 1000.;
+static constexpr double kSidechainReleaseDefaultMs = 200.;
+static constexpr double kSidechainDepthDefault = 0.5;
+
+//------------------------------------------------------------------------
+inline double normalizedToMs (double value, double minMs, double maxMs)
+{
+	return minMs + value * (maxMs - minMs);
+}
+
+//------------------------------------------------------------------------
+inline double msToNormalized (double ms, double minMs, double maxMs)
+{
+	return (ms - minMs) / (maxMs - minMs);
+}
+
+//------------------------------------------------------------------------
+// EnvelopeFollower: stereo linked peak follower with attack/release. The detector runs once per
+// frame (max of all sidechain channels) and writes the resulting gain of each frame into a buffer,
+// which is then applied to all main channels by the FrameGainStage (see againpipeline.h).
+//------------------------------------------------------------------------
+class EnvelopeFollower
+{
+public:
+	void setup (ProcessArena& arena, double newSampleRate, int32 maxSamplesPerBlock)
+	{
+		sampleRate = newSampleRate;
+		maxFrames = std::max<int32> (maxSamplesPerBlock, 1);
+		gains = arena.allocate<float> (maxFrames);
+		updateCoefficients ();
+		reset ();
+	}
+
+	void reset () { envelope = 0.; }
+
+	// audio thread, normalized parameter values (coefficients are only recomputed on change)
+	void setTimes (double attack, double release)
+	{
+		double newAttackMs = normalizedToMs (attack, kSidechainAttackMinMs, kSidechainAttackMaxMs);
+		double newReleaseMs =
+		    normalizedToMs (release, kSidechainReleaseMinMs, kSidechainReleaseMaxMs);
+		if (newAttackMs == attackMs && newReleaseMs == releaseMs)
+			return;
+		attackMs = newAttackMs;
+		releaseMs = newReleaseMs;
+		updateCoefficients ();
+	}
+
+	// computes the gain of each frame: baseGain reduced by depth * envelope (never below 0).
+	// AccumType is the precision of the detector state (double for offline processing).
+	template <typename SampleType, typename AccumType = float>
+	const float* process (SampleType** sideChain, int32 numChannels, int32 sampleFrames,
+	                      float baseGain, float depth)
+	{
+		sampleFrames = std::min<int32> (sampleFrames, maxFrames);
+		const AccumType attack = (AccumType)attackCoef;
+		const AccumType release = (AccumType)releaseCoef;
+		AccumType env = (AccumType)envelope;
+		for (int32 n = 0; n < sampleFrames; n++)
+		{
+			AccumType level = 0;
+			for (int32 i = 0; i < numChannels; i++)
+				level = std::max (level, (AccumType)std::abs (sideChain[i][n]));
+
+			env += (level > env ? attack : release) * (level - env);
+			gains[n] = (float)std::max<AccumType> (baseGain - depth * env, 0);
+		}
+		envelope = env;
+		return gains;
+	}
+
+	int32 getMaxFrames () const { return gains ? maxFrames : 0; }
+
+//------------------------------------------------------------------------
+private:
+	void updateCoefficients ()
+	{
+		attackCoef = 1. - std::exp (-1000. / (attackMs * sampleRate));
+		releaseCoef = 1. - std::exp (-1000. / (releaseMs * sampleRate));
+	}
+
+	float* gains {nullptr};
+	int32 maxFrames {0};
+	double sampleRate {44100.};
+	double attackMs {kSidechainAttackDefaultMs};
+	double releaseMs {kSidechainReleaseDefaultMs};
+	double attackCoef {0.};
+	double releaseCoef {0.};
+	double envelope {0.};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againhotstate.h
+// Description : AGain processing state read in every process call
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againenvelope.h"
+#include "againpipeline.h"
+#include "againquality.h"
+#include "againsaturation.h"
+#include "againtiling.h"
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Everything process () reads per block, packed into a single cache line
+//------------------------------------------------------------------------
+struct alignas (64) AGainHotState
+{
+	float fGain {1.f}; // default gain = 1.0
+	float fGainReduction {0.f};
+	float fVuPPMOld {0.f};
+	float fSidechainDepth {(float)kSidechainDepthDefault};
+	double fSidechainAttack {
+	    msToNormalized (kSidechainAttackDefaultMs, kSidechainAttackMinMs, kSidechainAttackMaxMs)};
+	double fSidechainRelease {msToNormalized (kSidechainReleaseDefaultMs, kSidechainReleaseMinMs,
+	                                          kSidechainReleaseMaxMs)};
+	int32 saturationMode {kSaturationOff};
+	int32 tileFrames {kMaxTileFrames}; // computed from the cache sizes in setupProcessing
+	int32 kernelVariant {kKernelGeneric}; // measured in setupProcessing (see againautotune.h)
+	QualityOptions quality;
+	bool bBypass {false};
+	bool bHalfGain {false};
+	bool bSideChainActive {false}; // cached in setActive (see againsmallblock.h)
+	bool bEventInputActive {true}; // cached in setActive (see againsmallblock.h)
+};
+
+static_assert (sizeof (AGainHotState) == 64, "AGainHotState has to fit in one cache line");
+
+//------------------------------------------------------------------------
+// the gain of a block before the sidechain: gain minus the reduction of the last note on
+inline float getBlockGain (const AGainHotState& hot)
+{
+	float gain = hot.fGain - hot.fGainReduction;
+	return hot.bHalfGain ? gain * 0.5f : gain;
+}
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
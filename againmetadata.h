@@ -0,0 +1,336 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againmetadata.h
+// Description : Parameter, unit, bus and MIDI mapping metadata of AGain, built once per process
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "againenvelope.h"
+#include "againmidilearn.h"
+#include "againparamids.h"
+#include "againprograms.h"
+#include "againsaturation.h"
+#include "againstems.h"
+
+#include "pluginterfaces/base/ustring.h"
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivsteditcontroller.h"
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
+#include "pluginterfaces/vst/ivstunits.h"
+#include "pluginterfaces/vst/vstspeaker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// The metadata never changes, so all strings (titles, units, names) are built on first use and
+// shared by every instance. Instances only copy the finished ParameterInfo/UnitInfo structures
+// into their own Parameter/Unit objects (the SDK classes keep them by value) instead of building
+// them again: initialize does no string formatting or conversion anymore.
+// The same tables are exported at build time for the host's plugin scan (see
+// againmetadataexport.h). initialize creates nothing outside of them; againmetadatatest.cpp
+// checks that the instances report what the exported file says.
+//------------------------------------------------------------------------
+struct ParameterMetadata
+{
+	enum Kind
+	{
+		kPlain, // Parameter
+		kGain, // GainParameter (dB display)
+		kList, // StringListParameter with listEntries
+		kRange // RangeParameter between minPlain and maxPlain
+	};
+
+	ParameterInfo info {};
+	Kind kind {kPlain};
+	ParamValue minPlain {0.};
+	ParamValue maxPlain {1.};
+	const TChar* const* listEntries {nullptr};
+	int32 numListEntries {0};
+};
+
+//------------------------------------------------------------------------
+// bus of the processor, in the order of creation (the bus index)
+struct BusMetadata
+{
+	String128 name {};
+	MediaType mediaType {kAudio};
+	BusDirection direction {kInput};
+	BusType busType {kMain};
+	int32 flags {BusInfo::kDefaultActive};
+	SpeakerArrangement arrangement {SpeakerArr::kStereo}; // audio busses
+	int32 channelCount {0}; // event busses
+};
+
+//------------------------------------------------------------------------
+// default MIDI mapping of the controller (event bus 0), replaced by what the user learns
+struct MidiMappingMetadata
+{
+	int16 channel;
+	CtrlNumber controller;
+	ParamID id;
+};
+
+//------------------------------------------------------------------------
+// program list of a unit, its program change parameter is part of the parameters
+struct ProgramListMetadata
+{
+	ProgramListInfo info {};
+	UnitID unitId {kRootUnitId};
+	const TChar* const* programNames {nullptr}; // info.programCount names
+};
+
+//------------------------------------------------------------------------
+struct MetadataTable
+{
+	std::vector<UnitInfo> units;
+	std::vector<ProgramListMetadata> programLists;
+	std::vector<ParameterMetadata> parameters;
+	std::vector<BusMetadata> busses;
+	std::vector<MidiMappingMetadata> midiMappings;
+};
+
+//------------------------------------------------------------------------
+inline UnitInfo makeUnitInfo (UnitID id, const char* name, UnitID parentUnitId = kRootUnitId,
+                              ProgramListID programListId = kNoProgramListId)
+{
+	UnitInfo unitInfo {};
+	unitInfo.id = id;
+	unitInfo.parentUnitId = parentUnitId; // attached to the root unit by default
+	unitInfo.programListId = programListId;
+	UString (unitInfo.name, USTRINGSIZE (unitInfo.name)).fromAscii (name);
+	return unitInfo;
+}
+
+//------------------------------------------------------------------------
+inline ParameterMetadata makeParameter (ParameterMetadata::Kind kind, const char* title,
+                                        const char* units, int32 stepCount,
+                                        ParamValue defaultNormalized, int32 flags, ParamID id,
+                                        UnitID unitId)
+{
+	ParameterMetadata parameter;
+	parameter.kind = kind;
+	ParameterInfo& info = parameter.info;
+	UString (info.title, USTRINGSIZE (info.title)).fromAscii (title);
+	if (units)
+		UString (info.units, USTRINGSIZE (info.units)).fromAscii (units);
+	info.stepCount = stepCount;
+	info.defaultNormalizedValue = defaultNormalized;
+	info.flags = flags;
+	info.id = id;
+	info.unitId = unitId;
+	return parameter;
+}
+
+//------------------------------------------------------------------------
+inline ParameterMetadata makeRangeParameter (const char* title, const char* units, ParamID id,
+                                             ParamValue minPlain, ParamValue maxPlain,
+                                             ParamValue defaultPlain, int32 flags, UnitID unitId)
+{
+	ParameterMetadata parameter =
+	    makeParameter (ParameterMetadata::kRange, title, units, 0,
+	                   (defaultPlain - minPlain) / (maxPlain - minPlain), flags, id, unitId);
+	parameter.minPlain = minPlain;
+	parameter.maxPlain = maxPlain;
+	return parameter;
+}
+
+//------------------------------------------------------------------------
+inline BusMetadata makeAudioBus (const char* name, BusDirection direction,
+                                 SpeakerArrangement arrangement, BusType busType = kMain,
+                                 int32 flags = BusInfo::kDefaultActive)
+{
+	BusMetadata bus;
+	UString (bus.name, USTRINGSIZE (bus.name)).fromAscii (name);
+	bus.direction = direction;
+	bus.busType = busType;
+	bus.flags = flags;
+	bus.arrangement = arrangement;
+	return bus;
+}
+
+//------------------------------------------------------------------------
+inline BusMetadata makeEventInput (const char* name, int32 channelCount)
+{
+	BusMetadata bus;
+	UString (bus.name, USTRINGSIZE (bus.name)).fromAscii (name);
+	bus.mediaType = kEvent;
+	bus.channelCount = channelCount;
+	return bus;
+}
+
+//------------------------------------------------------------------------
+// a program list and its program change parameter (a list of the program names, like the one
+// ProgramList::getParameter creates)
+inline void addProgramList (MetadataTable& table, const char* name, ProgramListID id,
+                            UnitID unitId, const TChar* const* programNames, int32 numPrograms)
+{
+	ProgramListMetadata programList;
+	programList.info.id = id;
+	UString (programList.info.name, USTRINGSIZE (programList.info.name)).fromAscii (name);
+	programList.info.programCount = numPrograms;
+	programList.unitId = unitId;
+	programList.programNames = programNames;
+	table.programLists.push_back (programList);
+
+	ParameterMetadata parameter = makeParameter (
+	    ParameterMetadata::kList, name, nullptr, numPrograms - 1, 0.,
+	    ParameterInfo::kCanAutomate | ParameterInfo::kIsList | ParameterInfo::kIsProgramChange, id,
+	    unitId);
+	parameter.listEntries = programNames;
+	parameter.numListEntries = numPrograms;
+	table.parameters.push_back (parameter);
+}
+
+//------------------------------------------------------------------------
+// creates the busses of a processor (AudioEffect) from its metadata
+template <typename Effect>
+inline void addBussesTo (Effect& effect, const MetadataTable& metadata)
+{
+	for (const BusMetadata& bus : metadata.busses)
+	{
+		if (bus.mediaType == kEvent)
+			effect.addEventInput (bus.name, bus.channelCount, bus.busType, bus.flags);
+		else if (bus.direction == kInput)
+			effect.addAudioInput (bus.name, bus.arrangement, bus.busType, bus.flags);
+		else
+			effect.addAudioOutput (bus.name, bus.arrangement, bus.busType, bus.flags);
+	}
+}
+
+//------------------------------------------------------------------------
+// AGain and AGainController
+//------------------------------------------------------------------------
+inline const MetadataTable& getAGainMetadata ()
+{
+	static const MetadataTable table = [] () {
+		static const TChar* const saturationModes[] = {STR16 ("Off"), STR16 ("2x"), STR16 ("4x"),
+		                                               STR16 ("8x")};
+
+		MetadataTable table;
+		// the root unit holds the program list (see againprograms.h)
+		table.units.push_back (makeUnitInfo (kRootUnitId, "Root", kNoParentUnitId, kProgramListId));
+		table.units.push_back (makeUnitInfo (1, "Unit1")); // unit1 for the gain
+
+		table.parameters.push_back (makeParameter (ParameterMetadata::kGain, "Gain", "dB", 0, 0.5,
+		                                           ParameterInfo::kCanAutomate, kGainId, 1));
+		table.parameters.push_back (makeParameter (ParameterMetadata::kPlain, "VuPPM", nullptr, 0,
+		                                           0., ParameterInfo::kIsReadOnly, kVuPPMId,
+		                                           kRootUnitId));
+		table.parameters.push_back (makeParameter (
+		    ParameterMetadata::kPlain, "Bypass", nullptr, 1, 0.,
+		    ParameterInfo::kCanAutomate | ParameterInfo::kIsBypass, kBypassId, kRootUnitId));
+
+		ParameterMetadata saturation = makeParameter (
+		    ParameterMetadata::kList, "Saturation", nullptr, kNumSaturationModes - 1, 0.,
+		    ParameterInfo::kCanAutomate | ParameterInfo::kIsList, kSaturationId, 1);
+		saturation.listEntries = saturationModes;
+		saturation.numListEntries = kNumSaturationModes;
+		table.parameters.push_back (saturation);
+
+		// used when the host activates the sidechain bus
+		table.parameters.push_back (makeParameter (ParameterMetadata::kPlain, "Sidechain Depth",
+		                                           nullptr, 0, kSidechainDepthDefault,
+		                                           ParameterInfo::kCanAutomate, kSidechainDepthId,
+		                                           1));
+		table.parameters.push_back (makeRangeParameter (
+		    "Sidechain Attack", "ms", kSidechainAttackId, kSidechainAttackMinMs,
+		    kSidechainAttackMaxMs, kSidechainAttackDefaultMs, ParameterInfo::kCanAutomate, 1));
+		table.parameters.push_back (makeRangeParameter (
+		    "Sidechain Release", "ms", kSidechainReleaseId, kSidechainReleaseMinMs,
+		    kSidechainReleaseMaxMs, kSidechainReleaseDefaultMs, ParameterInfo::kCanAutomate, 1));
+
+		table.parameters.push_back (makeParameter (ParameterMetadata::kPlain, "MIDI Learn", nullptr,
+		                                           1, 0., ParameterInfo::kIsHidden, kMidiLearnId,
+		                                           kRootUnitId));
+
+		// the factory programs (see againprograms.h) with their program change parameter
+		static const TChar* programNames[kNumPrograms] = {};
+		for (int32 i = 0; i < kNumPrograms; i++)
+			programNames[i] = getPrograms ().names[i];
+		addProgramList (table, "Factory", kProgramListId, kRootUnitId, programNames, kNumPrograms);
+
+		// stereo in/out (see setBusArrangements for the other arrangements), the optional
+		// sidechain (not active by default) and one event input with 16 channels, each one can
+		// have its MIDI mapping
+		table.busses.push_back (makeAudioBus ("Stereo In", kInput, SpeakerArr::kStereo));
+		table.busses.push_back (makeAudioBus ("Stereo Out", kOutput, SpeakerArr::kStereo));
+		table.busses.push_back (
+		    makeAudioBus ("Sidechain In", kInput, SpeakerArr::kStereo, kAux, 0));
+		table.busses.push_back (makeEventInput ("Event In", MidiLearnMap::kNumChannels));
+
+		// the volume controller of every channel drives the gain
+		for (int16 channel = 0; channel < MidiLearnMap::kNumChannels; channel++)
+			table.midiMappings.push_back ({channel, kCtrlVolume, kGainId});
+		return table;
+	}();
+	return table;
+}
+
+//------------------------------------------------------------------------
+// AGainStems and AGainStemsController: one unit per stem with its gain, bypass and meter
+//------------------------------------------------------------------------
+inline const MetadataTable& getStemsMetadata ()
+{
+	static const MetadataTable table = [] () {
+		MetadataTable table;
+		table.units.reserve (kNumStemBuses);
+		table.parameters.reserve (3 * kNumStemBuses + 1);
+		for (int32 i = 0; i < kNumStemBuses; i++)
+		{
+			char text[32];
+			UnitID unitId = kStemUnitBaseId + i;
+			snprintf (text, 32, "Stem %d", i + 1);
+			table.units.push_back (makeUnitInfo (unitId, text));
+
+			snprintf (text, 32, "Stem %d Gain", i + 1);
+			table.parameters.push_back (makeParameter (ParameterMetadata::kGain, text, "dB", 0,
+			                                           0.5, ParameterInfo::kCanAutomate,
+			                                           kStemGainBaseId + i, unitId));
+			snprintf (text, 32, "Stem %d Bypass", i + 1);
+			table.parameters.push_back (makeParameter (ParameterMetadata::kPlain, text, nullptr, 1,
+			                                           0., ParameterInfo::kCanAutomate,
+			                                           kStemBypassBaseId + i, unitId));
+			snprintf (text, 32, "Stem %d VuPPM", i + 1);
+			table.parameters.push_back (makeParameter (ParameterMetadata::kPlain, text, nullptr, 0,
+			                                           0., ParameterInfo::kIsReadOnly,
+			                                           kStemVuPPMBaseId + i, unitId));
+		}
+		table.parameters.push_back (makeParameter (ParameterMetadata::kPlain, "MIDI Learn", nullptr,
+		                                           1, 0., ParameterInfo::kIsHidden, kMidiLearnId,
+		                                           kRootUnitId));
+
+		// one stereo in/out pair per stem, only the first one is active by default
+		table.busses.reserve (2 * kNumStemBuses + 1);
+		for (int32 i = 0; i < kNumStemBuses; i++)
+		{
+			char text[32];
+			BusType type = i == 0 ? kMain : kAux;
+			int32 flags = i == 0 ? BusInfo::kDefaultActive : 0;
+			snprintf (text, 32, "Stem %d In", i + 1);
+			table.busses.push_back (makeAudioBus (text, kInput, SpeakerArr::kStereo, type, flags));
+			snprintf (text, 32, "Stem %d Out", i + 1);
+			table.busses.push_back (makeAudioBus (text, kOutput, SpeakerArr::kStereo, type, flags));
+		}
+		// MIDI controllers reach the stem parameters through the MIDI mapping of the controller
+		table.busses.push_back (makeEventInput ("Event In", MidiLearnMap::kNumChannels));
+
+		// the volume controller of MIDI channel n drives the gain of stem n
+		const int16 numMappedChannels =
+		    (int16)std::min<int32> (MidiLearnMap::kNumChannels, kNumStemBuses);
+		for (int16 channel = 0; channel < numMappedChannels; channel++)
+			table.midiMappings.push_back ({channel, kCtrlVolume, kStemGainBaseId + channel});
+		return table;
+	}();
+	return table;
+}
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
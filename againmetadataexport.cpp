@@ -0,0 +1,44 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againmetadataexport.cpp
+// Description : Build step writing the scan metadata of the AGain classes
+//-----------------------------------------------------------------------------
+#include "againmetadataexport.h"
+#include "againcids.h" // for class ids
+#include "againstemscids.h" // for class ids
+
+#include <cstdio>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// usage: againmetadataexport <file>
+// Run after linking the plugin, the file is copied to Contents/Resources/again.metadata.json of
+// the bundle (next to moduleinfo.json). It only uses the static tables, no class is instantiated.
+//------------------------------------------------------------------------
+int main (int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		fprintf (stderr, "usage: %s <file>\n", argv[0]);
+		return 1;
+	}
+	FILE* file = fopen (argv[1], "w");
+	if (!file)
+	{
+		fprintf (stderr, "[againmetadataexport] can not write %s\n", argv[1]);
+		return 1;
+	}
+
+	MetadataJsonWriter writer (file);
+	writer.begin ();
+	writer.writeClass (AGainProcessorUID, AGainControllerUID, getAGainMetadata ());
+	writer.writeClass (AGainStemsProcessorUID, AGainStemsControllerUID, getStemsMetadata ());
+	writer.end ();
+
+	bool ok = ferror (file) == 0;
+	return fclose (file) == 0 && ok ? 0 : 1;
+}
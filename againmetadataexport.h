@@ -0,0 +1,161 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againmetadataexport.h
+// Description : Export of the AGain metadata for the host's plugin scan
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "againmetadata.h"
+
+#include "pluginterfaces/base/funknown.h"
+#include "pluginterfaces/base/ustring.h"
+
+#include <cstdio>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// A host scanning a plugin folder has to instantiate each component and controller and call
+// initialize just to learn its busses, units and parameters. The moduleinfo.json of the bundle
+// (written by the SDK's moduleinfotool) already lists the classes without loading the binary; the
+// file written here adds what initialize would create, from the same tables (againmetadata.h):
+//
+//   { "Classes": [ { "CID", "Controller CID", "Busses", "Units", "Program Lists",
+//                    "Parameters", "MIDI Mappings" }, ... ] }
+//
+// The build writes it to Contents/Resources/again.metadata.json (see againmetadataexport.cpp).
+//------------------------------------------------------------------------
+class MetadataJsonWriter
+{
+public:
+	explicit MetadataJsonWriter (FILE* file) : file (file) {}
+
+	void begin () { fprintf (file, "{\n  \"Classes\": ["); }
+	void end () { fprintf (file, "\n  ]\n}\n"); }
+
+	void writeClass (const FUID& processorCid, const FUID& controllerCid,
+	                 const MetadataTable& metadata)
+	{
+		char8 processorText[33];
+		char8 controllerText[33];
+		processorCid.toString (processorText);
+		controllerCid.toString (controllerText);
+
+		fprintf (file, "%s\n    {\n", numClasses++ > 0 ? "," : "");
+		fprintf (file, "      \"CID\": \"%s\",\n", processorText);
+		fprintf (file, "      \"Controller CID\": \"%s\",\n", controllerText);
+
+		fprintf (file, "      \"Busses\": [");
+		for (size_t i = 0; i < metadata.busses.size (); i++)
+			writeBus (metadata.busses[i], i == 0);
+		fprintf (file, "\n      ],\n      \"Units\": [");
+		for (size_t i = 0; i < metadata.units.size (); i++)
+			writeUnit (metadata.units[i], i == 0);
+		fprintf (file, "\n      ],\n      \"Program Lists\": [");
+		for (size_t i = 0; i < metadata.programLists.size (); i++)
+			writeProgramList (metadata.programLists[i], i == 0);
+		fprintf (file, "\n      ],\n      \"Parameters\": [");
+		for (size_t i = 0; i < metadata.parameters.size (); i++)
+			writeParameter (metadata.parameters[i], i == 0);
+		fprintf (file, "\n      ],\n      \"MIDI Mappings\": [");
+		for (size_t i = 0; i < metadata.midiMappings.size (); i++)
+		{
+			const MidiMappingMetadata& mapping = metadata.midiMappings[i];
+			fprintf (file,
+			         "%s\n        {\"Bus\": 0, \"Channel\": %d, \"Controller\": %d, \"ID\": %u}",
+			         i == 0 ? "" : ",", mapping.channel, mapping.controller, mapping.id);
+		}
+		fprintf (file, "\n      ]\n    }");
+	}
+
+//------------------------------------------------------------------------
+private:
+	void writeBus (const BusMetadata& bus, bool first)
+	{
+		fprintf (file, "%s\n        {\"Name\": ", first ? "" : ",");
+		writeString (bus.name);
+		fprintf (file, ", \"Media Type\": \"%s\", \"Direction\": \"%s\", \"Type\": \"%s\", ",
+		         bus.mediaType == kEvent ? "Event" : "Audio",
+		         bus.direction == kInput ? "Input" : "Output",
+		         bus.busType == kMain ? "Main" : "Aux");
+		if (bus.mediaType == kEvent)
+			fprintf (file, "\"Channel Count\": %d, ", bus.channelCount);
+		else
+			fprintf (file, "\"Arrangement\": %llu, ", (unsigned long long)bus.arrangement);
+		fprintf (file, "\"Flags\": %d}", bus.flags);
+	}
+
+	void writeUnit (const UnitInfo& unit, bool first)
+	{
+		fprintf (file, "%s\n        {\"ID\": %d, \"Name\": ", first ? "" : ",", unit.id);
+		writeString (unit.name);
+		fprintf (file, ", \"Parent ID\": %d, \"Program List ID\": %d}", unit.parentUnitId,
+		         unit.programListId);
+	}
+
+	void writeProgramList (const ProgramListMetadata& programList, bool first)
+	{
+		fprintf (file, "%s\n        {\"ID\": %d, \"Name\": ", first ? "" : ",",
+		         programList.info.id);
+		writeString (programList.info.name);
+		fprintf (file, ", \"Unit ID\": %d, \"Programs\": [", programList.unitId);
+		for (int32 i = 0; i < programList.info.programCount; i++)
+		{
+			fprintf (file, i == 0 ? "" : ", ");
+			writeString (programList.programNames[i]);
+		}
+		fprintf (file, "]}");
+	}
+
+	void writeParameter (const ParameterMetadata& parameter, bool first)
+	{
+		const ParameterInfo& info = parameter.info;
+		fprintf (file, "%s\n        {\"ID\": %u, \"Title\": ", first ? "" : ",", info.id);
+		writeString (info.title);
+		fprintf (file, ", \"Units\": ");
+		writeString (info.units);
+		fprintf (file, ", \"Step Count\": %d, \"Default Normalized Value\": %.17g, ",
+		         info.stepCount, info.defaultNormalizedValue);
+		fprintf (file, "\"Unit ID\": %d, \"Flags\": %d", info.unitId, info.flags);
+		if (parameter.kind == ParameterMetadata::kRange)
+			fprintf (file, ", \"Min\": %.17g, \"Max\": %.17g", parameter.minPlain,
+			         parameter.maxPlain);
+		if (parameter.kind == ParameterMetadata::kList)
+		{
+			fprintf (file, ", \"Entries\": [");
+			for (int32 i = 0; i < parameter.numListEntries; i++)
+			{
+				fprintf (file, i == 0 ? "" : ", ");
+				writeString (parameter.listEntries[i]);
+			}
+			fprintf (file, "]");
+		}
+		fprintf (file, "}");
+	}
+
+	// the metadata strings are ASCII (built with fromAscii)
+	void writeString (const TChar* string)
+	{
+		char8 text[256];
+		UString (const_cast<TChar*> (string), 128).toAscii (text, 256);
+		fputc ('"', file);
+		for (const char8* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc ('\\', file);
+			if ((unsigned char)*c >= 0x20)
+				fputc (*c, file);
+		}
+		fputc ('"', file);
+	}
+
+	FILE* file;
+	int32 numClasses {0};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,243 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againmetadatatest.cpp
+// Description : Checks the exported metadata against initialized AGain instances
+//-----------------------------------------------------------------------------
+#include "again.h"
+#include "againcids.h" // for class ids
+#include "againcontroller.h"
+#include "againmetadataexport.h"
+#include "againstems.h"
+#include "againstemscids.h" // for class ids
+
+#include "public.sdk/source/vst/hosting/hostclasses.h"
+#include "public.sdk/source/vst/vstparameters.h"
+
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
+#include "pluginterfaces/vst/ivstunits.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// For AGain and AGainStems: a processor and a controller are created and initialized, everything
+// they report through the VST 3 interfaces (busses, units, program lists, parameters, MIDI
+// mapping) is collected into a MetadataTable and written with the MetadataJsonWriter. The result
+// has to be the file the build exports from the static tables. Returns 0 if both match.
+//------------------------------------------------------------------------
+class RuntimeMetadata
+{
+public:
+	RuntimeMetadata (IComponent* component, IAudioProcessor* processor,
+	                 EditControllerEx1* controller)
+	{
+		strings.reserve (kMaxStrings);
+		addBusses (component, processor);
+		addUnits (controller);
+		addParameters (controller);
+		addMidiMappings (controller);
+	}
+
+	const MetadataTable& getTable () const { return table; }
+
+//------------------------------------------------------------------------
+private:
+	static constexpr size_t kMaxStrings = 4096; // stable addresses for the table's name pointers
+
+	const TChar* keep (const TChar* string)
+	{
+		if (strings.size () == kMaxStrings)
+			return STR16 ("");
+		strings.emplace_back ();
+		std::copy (string, string + 128, strings.back ().begin ());
+		return strings.back ().data ();
+	}
+
+	void addBusses (IComponent* component, IAudioProcessor* processor)
+	{
+		for (MediaType mediaType : {kAudio, kEvent})
+		{
+			for (BusDirection direction : {kInput, kOutput})
+			{
+				for (int32 i = 0; i < component->getBusCount (mediaType, direction); i++)
+				{
+					BusInfo info {};
+					component->getBusInfo (mediaType, direction, i, info);
+					BusMetadata bus;
+					std::copy (info.name, info.name + 128, bus.name);
+					bus.mediaType = mediaType;
+					bus.direction = direction;
+					bus.busType = info.busType;
+					bus.flags = info.flags;
+					if (mediaType == kEvent)
+						bus.channelCount = info.channelCount;
+					else
+						processor->getBusArrangement (direction, i, bus.arrangement);
+					table.busses.push_back (bus);
+				}
+			}
+		}
+	}
+
+	void addUnits (EditControllerEx1* controller)
+	{
+		for (int32 i = 0; i < controller->getUnitCount (); i++)
+		{
+			UnitInfo info {};
+			controller->getUnitInfo (i, info);
+			table.units.push_back (info);
+		}
+		for (int32 i = 0; i < controller->getProgramListCount (); i++)
+		{
+			ProgramListMetadata programList;
+			controller->getProgramListInfo (i, programList.info);
+			for (const UnitInfo& unit : table.units)
+			{
+				if (unit.programListId == programList.info.id)
+					programList.unitId = unit.id;
+			}
+			names.emplace_back ();
+			for (int32 p = 0; p < programList.info.programCount; p++)
+			{
+				String128 name {};
+				controller->getProgramName (programList.info.id, p, name);
+				names.back ().push_back (keep (name));
+			}
+			programList.programNames = names.back ().data ();
+			table.programLists.push_back (programList);
+		}
+	}
+
+	void addParameters (EditControllerEx1* controller)
+	{
+		for (int32 i = 0; i < controller->getParameterCount (); i++)
+		{
+			ParameterMetadata parameter;
+			controller->getParameterInfo (i, parameter.info);
+			Parameter* object = controller->getParameterObject (parameter.info.id);
+			if (auto* range = dynamic_cast<RangeParameter*> (object))
+			{
+				parameter.kind = ParameterMetadata::kRange;
+				parameter.minPlain = range->getMin ();
+				parameter.maxPlain = range->getMax ();
+			}
+			else if (dynamic_cast<StringListParameter*> (object))
+			{
+				parameter.kind = ParameterMetadata::kList;
+				names.emplace_back ();
+				int32 stepCount = parameter.info.stepCount;
+				for (int32 s = 0; s <= stepCount; s++)
+				{
+					String128 entry {};
+					object->toString (stepCount > 0 ? (ParamValue)s / stepCount : 0., entry);
+					names.back ().push_back (keep (entry));
+				}
+				parameter.listEntries = names.back ().data ();
+				parameter.numListEntries = stepCount + 1;
+			}
+			table.parameters.push_back (parameter);
+		}
+	}
+
+	void addMidiMappings (EditControllerEx1* controller)
+	{
+		FUnknownPtr<IMidiMapping> midiMapping (controller->unknownCast ());
+		if (!midiMapping)
+			return;
+		for (int16 channel = 0; channel < MidiLearnMap::kNumChannels; channel++)
+		{
+			for (int16 number = 0; number < kCountCtrlNumber; number++)
+			{
+				ParamID id = kNoParamId;
+				tresult result = midiMapping->getMidiControllerAssignment (0, channel, number, id);
+				if (result == kResultTrue)
+					table.midiMappings.push_back ({channel, number, id});
+			}
+		}
+	}
+
+	MetadataTable table;
+	std::vector<std::array<TChar, 128>> strings;
+	std::vector<std::vector<const TChar*>> names; // moving the vectors keeps their data
+};
+
+//------------------------------------------------------------------------
+static std::string writeJson (const FUID& processorCid, const FUID& controllerCid,
+                              const MetadataTable& metadata)
+{
+	FILE* file = tmpfile ();
+	if (!file)
+		return {};
+	MetadataJsonWriter writer (file);
+	writer.begin ();
+	writer.writeClass (processorCid, controllerCid, metadata);
+	writer.end ();
+
+	std::string text;
+	rewind (file);
+	for (int c = fgetc (file); c != EOF; c = fgetc (file))
+		text += (char)c;
+	fclose (file);
+	return text;
+}
+
+//------------------------------------------------------------------------
+// the host sees the busses per media type and direction, the table has the order of creation
+static MetadataTable sortBusses (MetadataTable metadata)
+{
+	std::stable_sort (metadata.busses.begin (), metadata.busses.end (),
+	                  [] (const BusMetadata& a, const BusMetadata& b) {
+		                  return a.mediaType * 2 + a.direction < b.mediaType * 2 + b.direction;
+	                  });
+	return metadata;
+}
+
+//------------------------------------------------------------------------
+template <typename Processor, typename Controller>
+static int32 check (const char* name, HostApplication& host, const FUID& processorCid,
+                    const FUID& controllerCid, const MetadataTable& exported)
+{
+	auto* processor = static_cast<IAudioProcessor*> (Processor::createInstance (nullptr));
+	auto* controller = static_cast<EditControllerEx1*> (
+	    static_cast<IEditController*> (Controller::createInstance (nullptr)));
+	FUnknownPtr<IComponent> component (processor);
+	component->initialize (&host);
+	controller->initialize (&host);
+
+	std::string expected = writeJson (processorCid, controllerCid, sortBusses (exported));
+	std::string actual;
+	{
+		RuntimeMetadata runtime (component, processor, controller);
+		actual = writeJson (processorCid, controllerCid, runtime.getTable ());
+	}
+
+	controller->terminate ();
+	controller->release ();
+	component->terminate ();
+	processor->release ();
+
+	bool ok = !expected.empty () && expected == actual;
+	fprintf (stderr, "[againmetadatatest] %s: %s\n", name, ok ? "ok" : "differs");
+	if (!ok)
+		fprintf (stderr, "--- exported\n%s\n--- instance\n%s\n", expected.data (), actual.data ());
+	return ok ? 0 : 1;
+}
+
+//------------------------------------------------------------------------
+int main ()
+{
+	HostApplication host;
+	int32 failures = 0;
+	failures += check<AGain, AGainController> ("AGain", host, AGainProcessorUID,
+	                                           AGainControllerUID, getAGainMetadata ());
+	failures += check<AGainStems, AGainStemsController> (
+	    "AGainStems", host, AGainStemsProcessorUID, AGainStemsControllerUID, getStemsMetadata ());
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againmeterdemand.h
+// Description : Metering of AGain only while someone observes the meter
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include <atomic>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Message sent from the controller to the processor whenever the number of meter observers
+// changes between 0 and more: an open editor or the host writing the automation of the outputs
+// (IAutomationState::kWriteState). The controller sends it once when it is connected, so a
+// headless instance stops metering right away; a processor which never receives it (no
+// connection) keeps metering.
+static const char* const kMeterDemandMessageID = "MeterDemand";
+static const char* const kMeterDemandObservedAttr = "Observed";
+
+//------------------------------------------------------------------------
+// MeterObservers: controller side count of the observers (UI thread only)
+//------------------------------------------------------------------------
+struct MeterObservers
+{
+	int32 numEditors {0};
+	bool writingAutomation {false};
+
+	bool isObserved () const { return numEditors > 0 || writingAutomation; }
+};
+
+//------------------------------------------------------------------------
+// MeterDemand: processor side switch, set by notify (UI thread) and read once per process call.
+// Without observers process skips every meter computation (pipeline meter, analysis ring, output
+// parameter). The first block after a pause tells the caller to restart the meter from a clean
+// state, the values measured before the pause are stale.
+//------------------------------------------------------------------------
+class MeterDemand
+{
+public:
+	// UI thread (notify)
+	void setObserved (bool state) { observed.store (state, std::memory_order_relaxed); }
+
+	//--- audio thread ---
+	// returns true if the meter is computed in this block, resumed is true in the first block after
+	// a pause
+	bool update (bool& resumed)
+	{
+		bool state = observed.load (std::memory_order_relaxed);
+		resumed = state && !metering;
+		metering = state;
+		return metering;
+	}
+
+//------------------------------------------------------------------------
+private:
+	std::atomic<bool> observed {true};
+	bool metering {true}; // audio thread only
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againmidilearn.h
+// Description : MIDI learn controller mapping of the AGain controllers
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
+#include "pluginterfaces/vst/vsttypes.h"
+
+#include "base/source/fstreamer.h"
+
+#include <algorithm>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// the "MIDI Learn" switch of the editors (not automatable, ignored by the processors)
+static constexpr ParamID kMidiLearnId = 4000;
+
+//------------------------------------------------------------------------
+// MidiLearnMap: dense table of the parameter assigned to each event bus, MIDI channel and
+// controller (CC 0..127, aftertouch and pitch bend). The host asks for every incoming controller,
+// so the lookup is one index computation and one load: an out of range bus, channel or controller
+// is mapped to the last entry, which is always empty.
+//
+// Learning (UI thread only, like all IMidiMapping/IMidiLearn calls): while the learn switch is on,
+// the last parameter touched in the editor becomes the target, the next live controller input
+// (IMidiLearn) is assigned to it and the switch goes off.
+//------------------------------------------------------------------------
+class MidiLearnMap
+{
+public:
+	static constexpr int32 kMaxBuses = 1; // event inputs of AGain and AGainStems
+	static constexpr int32 kNumChannels = 16;
+	static constexpr int32 kNumControllers = kCountCtrlNumber;
+	static constexpr int32 kNumEntries = kMaxBuses * kNumChannels * kNumControllers;
+
+	MidiLearnMap () { clear (); }
+
+	void clear () { std::fill (entries, entries + kNumEntries + 1, kNoParamId); }
+
+	bool lookup (int32 busIndex, int16 channel, CtrlNumber controller, ParamID& tag) const
+	{
+		uint32 valid = ((uint32)busIndex < (uint32)kMaxBuses) &
+		               ((uint32)channel < (uint32)kNumChannels) &
+		               ((uint32)controller < (uint32)kNumControllers);
+		uint32 index = ((uint32)busIndex * kNumChannels + (uint32)channel) * kNumControllers +
+		               (uint32)controller;
+		tag = entries[valid * index + (1 - valid) * kNumEntries];
+		return tag != kNoParamId;
+	}
+
+	// kNoParamId removes the assignment
+	bool assign (int32 busIndex, int16 channel, CtrlNumber controller, ParamID tag)
+	{
+		if (busIndex < 0 || busIndex >= kMaxBuses || channel < 0 || channel >= kNumChannels ||
+		    controller < 0 || controller >= kNumControllers)
+			return false;
+		entries[(busIndex * kNumChannels + channel) * kNumControllers + controller] = tag;
+		return true;
+	}
+
+	//--- learning ---
+	void setLearning (bool state)
+	{
+		learning = state;
+		target = kNoParamId;
+	}
+
+	bool isLearning () const { return learning; }
+
+	void touch (ParamID tag)
+	{
+		if (learning && tag != kMidiLearnId)
+			target = tag;
+	}
+
+	// returns true if the controller was assigned (learning is finished then)
+	bool learn (int32 busIndex, int16 channel, CtrlNumber controller)
+	{
+		if (!learning || target == kNoParamId || !assign (busIndex, channel, controller, target))
+			return false;
+		setLearning (false);
+		return true;
+	}
+
+	//--- controller state: number of assignments, then bus, channel, controller, tag of each ---
+	bool write (IBStreamer& streamer) const
+	{
+		int32 count = (int32)std::count_if (entries, entries + kNumEntries,
+		                                    [] (ParamID tag) { return tag != kNoParamId; });
+		if (streamer.writeInt32 (count) == false)
+			return false;
+		for (int32 i = 0; i < kNumEntries; i++)
+		{
+			if (entries[i] == kNoParamId)
+				continue;
+			if (streamer.writeInt16 ((int16) (i / (kNumChannels * kNumControllers))) == false ||
+			    streamer.writeInt16 ((int16) ((i / kNumControllers) % kNumChannels)) == false ||
+			    streamer.writeInt16 ((int16) (i % kNumControllers)) == false ||
+			    streamer.writeInt32u (entries[i]) == false)
+				return false;
+		}
+		return true;
+	}
+
+	// false if the stream has no (or no complete) assignments, an older state for example: the
+	// current ones are kept then
+	bool read (IBStreamer& streamer)
+	{
+		int32 count = 0;
+		if (streamer.readInt32 (count) == false || count < 0)
+			return false;
+		MidiLearnMap parsed;
+		for (int32 i = 0; i < count; i++)
+		{
+			int16 busIndex = 0;
+			int16 channel = 0;
+			int16 controller = 0;
+			uint32 tag = kNoParamId;
+			if (streamer.readInt16 (busIndex) == false || streamer.readInt16 (channel) == false ||
+			    streamer.readInt16 (controller) == false || streamer.readInt32u (tag) == false)
+				return false;
+			parsed.assign (busIndex, channel, controller, tag);
+		}
+		std::copy (parsed.entries, parsed.entries + kNumEntries, entries);
+		return true;
+	}
+
+//------------------------------------------------------------------------
+private:
+	ParamID entries[kNumEntries + 1]; // + the empty entry of invalid lookups
+	ParamID target {kNoParamId};
+	bool learning {false};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
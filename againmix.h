@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againmix.h
+// Description : Channel mix of AGain for different input and output arrangements
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// MixMatrix: coefficient of each input channel in each output channel, used by the mix pipelines
+// (kPipelineMix, see againpipeline.h) when the main input and output have a different number of
+// channels:
+//   mono   -> stereo: the input on both sides (unity, like a centered mono voice)
+//   stereo -> mono:   (L + R) / 2
+//   5.1    -> stereo: ITU-R BS.775 downmix, L + 0.707 C + 0.707 Ls (R the same), no LFE
+//   5.1    -> mono:   the stereo downmix summed to mono
+// The 5.1 channel order is the one of SpeakerArr::k51: L R C Lfe Ls Rs.
+//------------------------------------------------------------------------
+static constexpr int32 kMaxMixInputs = 6;
+static constexpr int32 kMaxMixOutputs = 2;
+
+struct MixMatrix
+{
+	int32 numInputs {0};
+	int32 numOutputs {0};
+	float coefficients[kMaxMixOutputs][kMaxMixInputs] {};
+
+	static bool isSupported (int32 numInputs, int32 numOutputs)
+	{
+		return (numInputs == 1 || numInputs == 2 || numInputs == 6) &&
+		       (numOutputs == 1 || numOutputs == 2);
+	}
+
+	// numInputs == numOutputs (or not supported): identity, no mix pipeline needed
+	static MixMatrix create (int32 numInputs, int32 numOutputs)
+	{
+		MixMatrix mix;
+		if (numInputs == numOutputs || !isSupported (numInputs, numOutputs))
+			return mix;
+		mix.numInputs = numInputs;
+		mix.numOutputs = numOutputs;
+
+		const float kMinus3dB = 0.70710678f;
+		float stereo[2][kMaxMixInputs] = {};
+		switch (numInputs)
+		{
+			case 1:
+				stereo[0][0] = stereo[1][0] = 1.f;
+				break;
+			case 2:
+				stereo[0][0] = stereo[1][1] = 1.f;
+				break;
+			case 6:
+				stereo[0][0] = stereo[1][1] = 1.f; // L, R
+				stereo[0][2] = stereo[1][2] = kMinus3dB; // C
+				stereo[0][4] = stereo[1][5] = kMinus3dB; // Ls, Rs
+				break;
+		}
+		for (int32 i = 0; i < numInputs; i++)
+		{
+			if (numOutputs == 2)
+			{
+				mix.coefficients[0][i] = stereo[0][i];
+				mix.coefficients[1][i] = stereo[1][i];
+			}
+			else
+				mix.coefficients[0][i] = 0.5f * (stereo[0][i] + stereo[1][i]);
+		}
+		return mix;
+	}
+
+	bool isActive () const { return numOutputs > 0; }
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,231 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againparamsnapshot.h
+// Description : Lock-free parameter hand over between non realtime threads and the audio thread
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againhotstate.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// TripleBuffer: one writer and one reader thread exchange the latest value without blocking each
+// other. The reader only does one acquire load when nothing new was published.
+//------------------------------------------------------------------------
+template <typename T>
+class TripleBuffer
+{
+public:
+	// writer thread: fill getWriteBuffer () then publish
+	T& getWriteBuffer () { return buffers[writeIndex]; }
+	void publish ()
+	{
+		int32 previous = middle.exchange (writeIndex | kDirty, std::memory_order_acq_rel);
+		writeIndex = previous & kIndexMask;
+	}
+
+	// reader thread: returns the newest value or nullptr if nothing was published since last time
+	const T* fetch ()
+	{
+		if ((middle.load (std::memory_order_acquire) & kDirty) == 0)
+			return nullptr;
+		int32 previous = middle.exchange (readIndex, std::memory_order_acq_rel);
+		readIndex = previous & kIndexMask;
+		return &buffers[readIndex];
+	}
+
+	// reader thread: last fetched value
+	const T& getReadBuffer () const { return buffers[readIndex]; }
+
+//------------------------------------------------------------------------
+private:
+	static constexpr int32 kDirty = 4;
+	static constexpr int32 kIndexMask = 3;
+
+	T buffers[3] {};
+	int32 writeIndex {0};
+	int32 readIndex {1};
+	std::atomic<int32> middle {2};
+};
+
+//------------------------------------------------------------------------
+// ParameterSnapshot: the parameter part of AGainHotState, fields tells which values are valid
+//------------------------------------------------------------------------
+struct ParameterSnapshot
+{
+	enum Field : uint32
+	{
+		kGain = 1 << 0,
+		kGainReduction = 1 << 1,
+		kBypass = 1 << 2,
+		kHalfGain = 1 << 3,
+		kSaturationMode = 1 << 4,
+		kSidechain = 1 << 5,
+
+		kNumFields = 6,
+		kAllFields = (1 << kNumFields) - 1
+	};
+
+	uint32 fields {0};
+	uint64 sequence {0};
+
+	float fGain {1.f};
+	float fGainReduction {0.f};
+	float fSidechainDepth {(float)kSidechainDepthDefault};
+	double fSidechainAttack {AGainHotState ().fSidechainAttack};
+	double fSidechainRelease {AGainHotState ().fSidechainRelease};
+	int32 saturationMode {kSaturationOff};
+	bool bBypass {false};
+	bool bHalfGain {false};
+
+	void readFrom (const AGainHotState& hot)
+	{
+		fGain = hot.fGain;
+		fGainReduction = hot.fGainReduction;
+		fSidechainDepth = hot.fSidechainDepth;
+		fSidechainAttack = hot.fSidechainAttack;
+		fSidechainRelease = hot.fSidechainRelease;
+		saturationMode = hot.saturationMode;
+		bBypass = hot.bBypass;
+		bHalfGain = hot.bHalfGain;
+	}
+
+	void copyFields (const ParameterSnapshot& from, uint32 mask)
+	{
+		if (mask & kGain)
+			fGain = from.fGain;
+		if (mask & kGainReduction)
+			fGainReduction = from.fGainReduction;
+		if (mask & kBypass)
+			bBypass = from.bBypass;
+		if (mask & kHalfGain)
+			bHalfGain = from.bHalfGain;
+		if (mask & kSaturationMode)
+			saturationMode = from.saturationMode;
+		if (mask & kSidechain)
+		{
+			fSidechainDepth = from.fSidechainDepth;
+			fSidechainAttack = from.fSidechainAttack;
+			fSidechainRelease = from.fSidechainRelease;
+		}
+	}
+
+	void applyTo (AGainHotState& hot) const
+	{
+		if (fields & kGain)
+			hot.fGain = fGain;
+		if (fields & kGainReduction)
+			hot.fGainReduction = fGainReduction;
+		if (fields & kBypass)
+			hot.bBypass = bBypass;
+		if (fields & kHalfGain)
+			hot.bHalfGain = bHalfGain;
+		if (fields & kSaturationMode)
+			hot.saturationMode = saturationMode;
+		if (fields & kSidechain)
+		{
+			hot.fSidechainDepth = fSidechainDepth;
+			hot.fSidechainAttack = fSidechainAttack;
+			hot.fSidechainRelease = fSidechainRelease;
+		}
+	}
+};
+
+//------------------------------------------------------------------------
+// ParameterMailbox: non realtime threads (setState, receiveText,...) publish changed fields, the
+// audio thread picks them up once per block; the audio thread publishes its current values back
+// (only in blocks where something changed) so that getState never reads the live hot state.
+// The values published back carry the sequence of the last snapshot applied to them: until they
+// arrive, readCurrent keeps overriding them with the changes of later sequences, even if the audio
+// thread has already fetched these changes.
+//------------------------------------------------------------------------
+class ParameterMailbox
+{
+public:
+	//--- non realtime threads (serialized between each other, never blocks the audio thread) ---
+	template <typename Func>
+	void publish (uint32 fields, Func&& modify)
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		modify (writerState);
+
+		uint64 sequence = ++writerSequence;
+		for (uint32 i = 0; i < ParameterSnapshot::kNumFields; i++)
+			if (fields & (1u << i))
+				fieldSequence[i] = sequence;
+
+		// everything the audio thread has not fetched yet (a snapshot replaced before it was
+		// fetched is lost, its fields are sent again)
+		ParameterSnapshot& snapshot = toAudio.getWriteBuffer ();
+		snapshot = writerState;
+		snapshot.fields = getFieldsChangedAfter (deliveredSequence.load (std::memory_order_acquire));
+		snapshot.sequence = sequence;
+		toAudio.publish ();
+	}
+
+	// the current values: the audio thread's values overridden by the changes they do not contain
+	// yet (fetched or not)
+	ParameterSnapshot readCurrent ()
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		fromAudio.fetch ();
+		ParameterSnapshot current = fromAudio.getReadBuffer ();
+		current.copyFields (writerState, getFieldsChangedAfter (current.sequence));
+		return current;
+	}
+
+	//--- audio thread ---
+	const ParameterSnapshot* fetch ()
+	{
+		const ParameterSnapshot* snapshot = toAudio.fetch ();
+		if (snapshot)
+		{
+			appliedSequence = snapshot->sequence;
+			deliveredSequence.store (snapshot->sequence, std::memory_order_release);
+		}
+		return snapshot;
+	}
+
+	void publishFromAudio (const AGainHotState& hot)
+	{
+		ParameterSnapshot& snapshot = fromAudio.getWriteBuffer ();
+		snapshot.readFrom (hot);
+		snapshot.fields = ParameterSnapshot::kAllFields;
+		snapshot.sequence = appliedSequence;
+		fromAudio.publish ();
+	}
+
+//------------------------------------------------------------------------
+private:
+	uint32 getFieldsChangedAfter (uint64 sequence) const
+	{
+		uint32 fields = 0;
+		for (uint32 i = 0; i < ParameterSnapshot::kNumFields; i++)
+			if (fieldSequence[i] > sequence)
+				fields |= 1u << i;
+		return fields;
+	}
+
+	TripleBuffer<ParameterSnapshot> toAudio;
+	TripleBuffer<ParameterSnapshot> fromAudio;
+	std::atomic<uint64> deliveredSequence {0}; // last snapshot fetched by the audio thread
+	uint64 appliedSequence {0}; // audio thread only
+
+	std::mutex writerMutex;
+	ParameterSnapshot writerState;
+	uint64 writerSequence {0};
+	uint64 fieldSequence[ParameterSnapshot::kNumFields] {};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
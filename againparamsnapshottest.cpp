@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againparamsnapshottest.cpp
+// Description : Stress test of the ParameterMailbox (build it with -fsanitize=thread)
+//-----------------------------------------------------------------------------
+#include "againparamsnapshot.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// The threads of a running processor at full speed:
+// - audio:       fetch, apply, publish back (like process)
+// - setState:    publishes gain and gain reduction as a pair (gain == -reduction), then reads the
+//                current values back, which have to be the ones just written (getState after
+//                setState)
+// - receiveText: toggles the half gain flag
+// - getState:    reads the current values, the pair must never be torn
+// Returns 0 when every check passed; ThreadSanitizer reports any data race on top.
+//------------------------------------------------------------------------
+static constexpr int32 kNumStates = 200000;
+static constexpr int32 kNumToggles = 100001;
+
+//------------------------------------------------------------------------
+int main ()
+{
+	ParameterMailbox mailbox;
+	std::atomic<bool> writersDone {false};
+	std::atomic<int32> failures {0};
+	AGainHotState hot;
+	hot.fGain = 0.f; // the pair (gain == -reduction) from the start
+
+	std::thread audio ([&] () {
+		bool drained = false;
+		while (!drained)
+		{
+			// one more round after the writers are done picks up their last snapshot
+			drained = writersDone.load ();
+			if (const ParameterSnapshot* snapshot = mailbox.fetch ())
+			{
+				snapshot->applyTo (hot);
+				mailbox.publishFromAudio (hot);
+			}
+			if (hot.fGain != -hot.fGainReduction)
+				failures++;
+		}
+	});
+
+	std::thread setState ([&] () {
+		for (int32 i = 1; i <= kNumStates; i++)
+		{
+			mailbox.publish (ParameterSnapshot::kGain | ParameterSnapshot::kGainReduction,
+			                 [&] (ParameterSnapshot& snapshot) {
+				                 snapshot.fGain = (float)i;
+				                 snapshot.fGainReduction = -(float)i;
+			                 });
+			ParameterSnapshot current = mailbox.readCurrent ();
+			if (current.fGain != (float)i || current.fGainReduction != -(float)i)
+				failures++;
+		}
+	});
+
+	std::thread receiveText ([&] () {
+		for (int32 i = 0; i < kNumToggles; i++)
+			mailbox.publish (ParameterSnapshot::kHalfGain, [] (ParameterSnapshot& snapshot) {
+				snapshot.bHalfGain = !snapshot.bHalfGain;
+			});
+	});
+
+	std::thread getState ([&] () {
+		while (!writersDone.load ())
+		{
+			ParameterSnapshot current = mailbox.readCurrent ();
+			if (current.fGain != -current.fGainReduction && current.fGain != 1.f)
+				failures++;
+		}
+	});
+
+	setState.join ();
+	receiveText.join ();
+	writersDone = true;
+	audio.join ();
+	getState.join ();
+
+	// every change arrived in the audio thread
+	if (hot.fGain != (float)kNumStates || hot.bHalfGain != (kNumToggles % 2 == 1))
+		failures++;
+	ParameterSnapshot current = mailbox.readCurrent ();
+	if (current.fGain != (float)kNumStates || current.bHalfGain != hot.bHalfGain)
+		failures++;
+
+	fprintf (stderr, "[againparamsnapshottest] %d failures\n", failures.load ());
+	return failures.load () == 0 ? 0 : 1;
+}
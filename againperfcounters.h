@@ -0,0 +1,273 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againperfcounters.h
+// Description : Hardware performance counters around the AGain process call (Linux)
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againpipeline.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#if SMTG_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define AGAIN_PERF_COUNTERS 1
+#else
+#define AGAIN_PERF_COUNTERS 0
+#endif
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Opt-in (AGAIN_PERF_COUNTERS=1) instrumentation: the counters below are read before and after
+// each process call and accumulated per kernel variant and block size, which tells whether a
+// configuration is bound by compute (instructions per cycle), memory (cache misses) or branches.
+// Reading the counters costs two system calls per process call, so the mode is for measuring
+// only. perf_event_paranoid has to allow user space counting (<= 2), otherwise nothing is counted.
+//------------------------------------------------------------------------
+enum PerfCounter
+{
+	kPerfCycles = 0,
+	kPerfInstructions,
+	kPerfL1DMisses, // L1 data cache read misses
+	kPerfLLCMisses, // last level cache misses
+	kPerfBranchMisses,
+
+	kNumPerfCounters
+};
+
+//------------------------------------------------------------------------
+// PerfCounterGroup: the counters of the calling thread, opened as one group (read at once)
+//------------------------------------------------------------------------
+class PerfCounterGroup
+{
+public:
+	// the group of the calling thread, opened on first use
+	static PerfCounterGroup& getForThisThread ()
+	{
+		static thread_local PerfCounterGroup group;
+		return group;
+	}
+
+	~PerfCounterGroup ()
+	{
+#if AGAIN_PERF_COUNTERS
+		for (int32 i = kNumPerfCounters - 1; i >= 0; i--)
+			if (fds[i] >= 0)
+				close (fds[i]);
+#endif
+	}
+
+	bool isOpen () const { return numOpen > 0; }
+
+	// values of the counters (0 for a counter not available on this system)
+	bool read (uint64 values[kNumPerfCounters]) const
+	{
+#if AGAIN_PERF_COUNTERS
+		if (numOpen == 0)
+			return false;
+		uint64 buffer[1 + kNumPerfCounters] = {}; // PERF_FORMAT_GROUP: count, then the values
+		if (::read (fds[leader], buffer, sizeof (buffer)) < (ssize_t) (sizeof (uint64) * 2))
+			return false;
+		for (int32 i = 0; i < kNumPerfCounters; i++)
+			values[i] = position[i] >= 0 ? buffer[1 + position[i]] : 0;
+		return true;
+#else
+		(void)values;
+		return false;
+#endif
+	}
+
+//------------------------------------------------------------------------
+private:
+	PerfCounterGroup ()
+	{
+#if AGAIN_PERF_COUNTERS
+		const uint64 l1dReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		const struct
+		{
+			uint32 type;
+			uint64 config;
+		} events[kNumPerfCounters] = {
+		    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+		    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+		    {PERF_TYPE_HW_CACHE, l1dReadMiss},
+		    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+		    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+		};
+
+		for (int32 i = 0; i < kNumPerfCounters; i++)
+		{
+			perf_event_attr attr;
+			memset (&attr, 0, sizeof (attr));
+			attr.size = sizeof (attr);
+			attr.type = events[i].type;
+			attr.config = events[i].config;
+			attr.read_format = PERF_FORMAT_GROUP;
+			attr.exclude_kernel = 1; // allowed with perf_event_paranoid 2
+			attr.exclude_hv = 1;
+
+			// this thread on any CPU, the first available counter leads the group
+			int groupFd = numOpen > 0 ? fds[leader] : -1;
+			fds[i] = (int)syscall (__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+			if (fds[i] < 0)
+				continue; // not supported here (virtual machines often lack cache events)
+			if (numOpen == 0)
+				leader = i;
+			position[i] = numOpen++;
+		}
+#endif
+	}
+
+	int fds[kNumPerfCounters] {-1, -1, -1, -1, -1};
+	int32 position[kNumPerfCounters] {-1, -1, -1, -1, -1}; // in the group read
+	int32 leader {0};
+	int32 numOpen {0};
+};
+
+//------------------------------------------------------------------------
+// PerfCounters: per instance accumulators, written by the audio thread (the only writer, so a
+// relaxed load and store instead of a locked increment) and read by any thread with report/forEach
+//------------------------------------------------------------------------
+class PerfCounters
+{
+public:
+	static constexpr int32 kNumBlockSizeBuckets = 14; // 1, 2-3, 4-7, ... 8192 and more frames
+
+	struct Entry
+	{
+		uint64 calls;
+		uint64 frames;
+		uint64 counters[kNumPerfCounters];
+	};
+
+	// non realtime thread (setupProcessing)
+	void setEnabled (bool state) { enabled.store (state, std::memory_order_relaxed); }
+	bool isEnabled () const { return enabled.load (std::memory_order_relaxed); }
+
+	static int32 getBlockSizeBucket (int32 sampleFrames)
+	{
+		int32 bucket = 0;
+		while (bucket < kNumBlockSizeBuckets - 1 && (sampleFrames >> (bucket + 1)) > 0)
+			bucket++;
+		return bucket;
+	}
+
+	//--- audio thread ---
+	void add (int32 variant, int32 sampleFrames, const uint64 start[kNumPerfCounters],
+	          const uint64 end[kNumPerfCounters])
+	{
+		if (variant < 0 || variant >= kNumKernelVariants)
+			return;
+		Accumulator& accumulator = accumulators[variant][getBlockSizeBucket (sampleFrames)];
+		increment (accumulator.calls, 1);
+		increment (accumulator.frames, (uint64)sampleFrames);
+		for (int32 i = 0; i < kNumPerfCounters; i++)
+			increment (accumulator.counters[i], end[i] - start[i]);
+	}
+
+	//--- any thread ---
+	// func (KernelVariant variant, int32 bucket, const Entry& entry) for each used combination
+	template <typename Func>
+	void forEach (Func&& func) const
+	{
+		for (int32 v = 0; v < kNumKernelVariants; v++)
+		{
+			for (int32 b = 0; b < kNumBlockSizeBuckets; b++)
+			{
+				const Accumulator& accumulator = accumulators[v][b];
+				Entry entry;
+				entry.calls = accumulator.calls.load (std::memory_order_relaxed);
+				if (entry.calls == 0)
+					continue;
+				entry.frames = accumulator.frames.load (std::memory_order_relaxed);
+				for (int32 i = 0; i < kNumPerfCounters; i++)
+					entry.counters[i] = accumulator.counters[i].load (std::memory_order_relaxed);
+				func ((KernelVariant)v, b, entry);
+			}
+		}
+	}
+
+	void report (FILE* file) const
+	{
+		fprintf (file, "[AGain] performance counters (per call)\n");
+		fprintf (file, "variant  frames     calls      cycles   instr   IPC  L1D-miss  LLC-miss "
+		               "br-miss\n");
+		forEach ([&] (KernelVariant variant, int32 bucket, const Entry& entry) {
+			double calls = (double)entry.calls;
+			double cycles = (double)entry.counters[kPerfCycles];
+			fprintf (file, "%-7s %6d+ %9llu %11.0f %7.0f %5.2f %9.1f %9.1f %7.1f\n",
+			         getKernelVariantName (variant), 1 << bucket, (unsigned long long)entry.calls,
+			         cycles / calls, (double)entry.counters[kPerfInstructions] / calls,
+			         cycles > 0 ? (double)entry.counters[kPerfInstructions] / cycles : 0.,
+			         (double)entry.counters[kPerfL1DMisses] / calls,
+			         (double)entry.counters[kPerfLLCMisses] / calls,
+			         (double)entry.counters[kPerfBranchMisses] / calls);
+		});
+	}
+
+//------------------------------------------------------------------------
+private:
+	struct Accumulator
+	{
+		std::atomic<uint64> calls {0};
+		std::atomic<uint64> frames {0};
+		std::atomic<uint64> counters[kNumPerfCounters] {};
+	};
+
+	static void increment (std::atomic<uint64>& value, uint64 delta)
+	{
+		value.store (value.load (std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+	}
+
+	std::atomic<bool> enabled {false};
+	Accumulator accumulators[kNumKernelVariants][kNumBlockSizeBuckets];
+};
+
+//------------------------------------------------------------------------
+// PerfCounterScope: counts the lifetime of the scope (the process call) when enabled
+//------------------------------------------------------------------------
+class PerfCounterScope
+{
+public:
+	PerfCounterScope (PerfCounters& counters, int32 variant, int32 sampleFrames)
+	: counters (counters), variant (variant), sampleFrames (sampleFrames)
+	{
+		if (counters.isEnabled ())
+		{
+			group = &PerfCounterGroup::getForThisThread ();
+			if (!group->read (start))
+				group = nullptr;
+		}
+	}
+
+	~PerfCounterScope ()
+	{
+		uint64 end[kNumPerfCounters];
+		if (group && group->read (end))
+			counters.add (variant, sampleFrames, start, end);
+	}
+
+//------------------------------------------------------------------------
+private:
+	PerfCounters& counters;
+	const PerfCounterGroup* group {nullptr};
+	int32 variant;
+	int32 sampleFrames;
+	uint64 start[kNumPerfCounters];
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
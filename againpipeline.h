@@ -0,0 +1,525 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againpipeline.h
+// Description : Compile time composed per sample processing of AGain
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+#include "pluginterfaces/vst/vsttypes.h"
+
+#include "againmix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// A pipeline is a list of stages fused into one loop over each tile: every sample is read once,
+// passes all stages in registers and is written once. A stage is a struct with a static, inlined
+//     template <typename T> T tick (T x, int32 frame, const PipelineContext& context, T& peak)
+// so an unused feature is simply not part of the list (no branch, no call, no extra pass).
+// All combinations of the runtime options are instantiated up front, process () selects one
+// function pointer per block (see getPipeline).
+//------------------------------------------------------------------------
+struct PipelineContext
+{
+	float gain {1.f};
+	const float* gains {nullptr}; // gain of each frame (sidechain), used by FrameGainStage
+	const MixMatrix* mix {nullptr}; // input channels of each output channel (kPipelineMix)
+};
+
+//------------------------------------------------------------------------
+struct IdentityStage // bypass: the input is copied
+{
+	template <typename T>
+	static inline T tick (T x, int32 /*frame*/, const PipelineContext& /*context*/, T& /*peak*/)
+	{
+		return x;
+	}
+};
+
+//------------------------------------------------------------------------
+struct GainStage
+{
+	template <typename T>
+	static inline T tick (T x, int32 /*frame*/, const PipelineContext& context, T& /*peak*/)
+	{
+		return x * context.gain;
+	}
+};
+
+//------------------------------------------------------------------------
+struct FrameGainStage // the gain of each frame computed by the EnvelopeFollower
+{
+	template <typename T>
+	static inline T tick (T x, int32 frame, const PipelineContext& context, T& /*peak*/)
+	{
+		return x * context.gains[frame];
+	}
+};
+
+//------------------------------------------------------------------------
+struct SanitizeStage // NaN, infinity and denormals become 0 (protects everything after us)
+{
+	template <typename T>
+	static inline T tick (T x, int32 /*frame*/, const PipelineContext& /*context*/, T& /*peak*/)
+	{
+		T magnitude = std::abs (x);
+		// false for NaN too
+		return (magnitude >= std::numeric_limits<T>::min () &&
+		        magnitude <= std::numeric_limits<T>::max ()) ?
+		           x :
+		           T (0);
+	}
+};
+
+//------------------------------------------------------------------------
+struct NoStage
+{
+	template <typename T>
+	static inline T tick (T x, int32 /*frame*/, const PipelineContext& /*context*/, T& /*peak*/)
+	{
+		return x;
+	}
+};
+
+//------------------------------------------------------------------------
+struct PeakMeterStage // check only positive values
+{
+	template <typename T>
+	static inline T tick (T x, int32 /*frame*/, const PipelineContext& /*context*/, T& peak)
+	{
+		peak = std::max (peak, x);
+		return x;
+	}
+};
+
+//------------------------------------------------------------------------
+struct AbsolutePeakMeterStage // negative half waves too (offline quality)
+{
+	template <typename T>
+	static inline T tick (T x, int32 /*frame*/, const PipelineContext& /*context*/, T& peak)
+	{
+		peak = std::max (peak, std::abs (x));
+		return x;
+	}
+};
+
+//------------------------------------------------------------------------
+// Kernel variants: the same pipelines compiled for wider vector units, chosen at runtime (see
+// againautotune.h). Only x86-64 with GCC/Clang has more than the generic variant (the baseline of
+// the build, SSE2 on x86-64, NEON on arm64).
+//------------------------------------------------------------------------
+enum KernelVariant : int32
+{
+	kKernelGeneric = 0,
+	kKernelAVX2,
+	kKernelAVX512,
+
+	kNumKernelVariants
+};
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define AGAIN_KERNEL_VARIANTS 1
+#define AGAIN_ALWAYS_INLINE inline __attribute__ ((always_inline))
+#define AGAIN_TARGET(isa) __attribute__ ((target (isa)))
+// keeps a loop over lanes a loop, so it is vectorized as a whole (GCC -O3 unrolls it completely
+// first and then converts between double and float lane by lane)
+#define AGAIN_NO_UNROLL _Pragma ("GCC unroll 1")
+#else
+#define AGAIN_KERNEL_VARIANTS 0
+#define AGAIN_ALWAYS_INLINE inline
+#define AGAIN_NO_UNROLL
+#endif
+
+//------------------------------------------------------------------------
+inline bool isKernelVariantSupported (KernelVariant variant)
+{
+	switch (variant)
+	{
+		case kKernelGeneric: return true;
+#if AGAIN_KERNEL_VARIANTS
+		case kKernelAVX2: return __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+		case kKernelAVX512: return __builtin_cpu_supports ("avx512f");
+#endif
+		default: return false;
+	}
+}
+
+//------------------------------------------------------------------------
+inline const char* getKernelVariantName (KernelVariant variant)
+{
+	static const char* names[] = {"generic", "avx2", "avx512"};
+	return variant >= 0 && variant < kNumKernelVariants ? names[variant] : "";
+}
+
+//------------------------------------------------------------------------
+// runs the stages in order on every sample, tile by tile (see againtiling.h), returns the peak.
+// Always inlined, so each variant below compiles the whole loop for its instruction set.
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+AGAIN_ALWAYS_INLINE SampleType runPipelineBody (SampleType** in, SampleType** out,
+                                                int32 numChannels, int32 sampleFrames,
+                                                int32 tileFrames, const PipelineContext& context)
+{
+	SampleType vuPPM = 0;
+	for (int32 offset = 0; offset < sampleFrames; offset += tileFrames)
+	{
+		int32 end = std::min<int32> (offset + tileFrames, sampleFrames);
+		for (int32 i = 0; i < numChannels; i++)
+		{
+			const SampleType* ptrIn = in[i];
+			SampleType* ptrOut = out[i];
+
+			// one cache line per step, each lane has its own peak: the loop body has no
+			// dependency between the lanes and maps to one vector operation per stage
+			constexpr int32 L = 64 / sizeof (SampleType);
+			SampleType peaks[L] = {};
+			int32 n = offset;
+			for (; n + L <= end; n += L)
+			{
+				for (int32 l = 0; l < L; l++)
+				{
+					SampleType x = ptrIn[n + l];
+					((x = Stages::template tick<SampleType> (x, n + l, context, peaks[l])), ...);
+					ptrOut[n + l] = x;
+				}
+			}
+			for (; n < end; n++)
+			{
+				SampleType x = ptrIn[n];
+				((x = Stages::template tick<SampleType> (x, n, context, peaks[0])), ...);
+				ptrOut[n] = x;
+			}
+			for (int32 l = 0; l < L; l++)
+				vuPPM = std::max (vuPPM, peaks[l]);
+		}
+	}
+	return vuPPM;
+}
+
+//------------------------------------------------------------------------
+// the same with context.mix in front of the stages: each output channel is the weighted sum of the
+// input channels (numChannels is the number of outputs). All outputs of a cache line are computed
+// before any of them is written, so in place buffers (out[0] == in[0]) stay correct.
+//------------------------------------------------------------------------
+template <typename SampleType, int32 NumLanes, typename... Stages>
+AGAIN_ALWAYS_INLINE void runMixFrames (SampleType** in, SampleType** out, int32 numChannels,
+                                       int32 n, const PipelineContext& context,
+                                       SampleType* peaks)
+{
+	const MixMatrix& mix = *context.mix;
+	SampleType x[kMaxMixOutputs][NumLanes] = {};
+	for (int32 i = 0; i < mix.numInputs; i++)
+	{
+		const SampleType* ptrIn = in[i] + n;
+		for (int32 o = 0; o < numChannels; o++)
+		{
+			const SampleType coefficient = mix.coefficients[o][i];
+			for (int32 l = 0; l < NumLanes; l++)
+				x[o][l] += coefficient * ptrIn[l];
+		}
+	}
+	for (int32 o = 0; o < numChannels; o++)
+	{
+		SampleType* ptrOut = out[o] + n;
+		for (int32 l = 0; l < NumLanes; l++)
+		{
+			SampleType y = x[o][l];
+			((y = Stages::template tick<SampleType> (y, n + l, context, peaks[l])), ...);
+			ptrOut[l] = y;
+		}
+	}
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+AGAIN_ALWAYS_INLINE SampleType runMixPipelineBody (SampleType** in, SampleType** out,
+                                                   int32 numChannels, int32 sampleFrames,
+                                                   int32 tileFrames, const PipelineContext& context)
+{
+	numChannels = std::min<int32> (numChannels, context.mix->numOutputs);
+
+	constexpr int32 L = 64 / sizeof (SampleType);
+	SampleType peaks[L] = {};
+	for (int32 offset = 0; offset < sampleFrames; offset += tileFrames)
+	{
+		int32 end = std::min<int32> (offset + tileFrames, sampleFrames);
+		int32 n = offset;
+		for (; n + L <= end; n += L)
+			runMixFrames<SampleType, L, Stages...> (in, out, numChannels, n, context, peaks);
+		for (; n < end; n++)
+			runMixFrames<SampleType, 1, Stages...> (in, out, numChannels, n, context, peaks);
+	}
+
+	SampleType vuPPM = 0;
+	for (int32 l = 0; l < L; l++)
+		vuPPM = std::max (vuPPM, peaks[l]);
+	return vuPPM;
+}
+
+//------------------------------------------------------------------------
+// kPipelineFloatCompute: double buffers (kSample64 hosts), the stages run on float. Each step
+// takes 16 frames (one cache line of float) through three loops without dependencies between the
+// lanes: a packed load and convert to float, the stages at the vector width of float and a packed
+// convert and store, so each loop maps to a few vector instructions.
+// Error bound of the gain and meter: the input rounding and the product rounding, each at most
+// 2^-24 relative, so below 1.2e-7 relative (-138 dB) per sample, 1.1e-7 measured with frame gains
+// and 5.9e-8 for the peak (benchmarkFloatCompute of againbenchmark.cpp). Values beyond the float
+// range become infinity (0 with the sanitizer), values below it lose precision.
+//------------------------------------------------------------------------
+template <typename... Stages>
+AGAIN_ALWAYS_INLINE Sample64 runFloatComputeBody (Sample64** in, Sample64** out, int32 numChannels,
+                                                  int32 sampleFrames, int32 tileFrames,
+                                                  const PipelineContext& context)
+{
+	float vuPPM = 0;
+	for (int32 offset = 0; offset < sampleFrames; offset += tileFrames)
+	{
+		int32 end = std::min<int32> (offset + tileFrames, sampleFrames);
+		for (int32 i = 0; i < numChannels; i++)
+		{
+			const Sample64* ptrIn = in[i];
+			Sample64* ptrOut = out[i];
+
+			constexpr int32 L = 64 / sizeof (float);
+			float peaks[L] = {};
+			int32 n = offset;
+			for (; n + L <= end; n += L)
+			{
+				float x[L];
+				AGAIN_NO_UNROLL
+				for (int32 l = 0; l < L; l++)
+					x[l] = static_cast<float> (ptrIn[n + l]);
+				AGAIN_NO_UNROLL
+				for (int32 l = 0; l < L; l++)
+					((x[l] = Stages::template tick<float> (x[l], n + l, context, peaks[l])), ...);
+				AGAIN_NO_UNROLL
+				for (int32 l = 0; l < L; l++)
+					ptrOut[n + l] = x[l];
+			}
+			for (; n < end; n++)
+			{
+				float x = static_cast<float> (ptrIn[n]);
+				((x = Stages::template tick<float> (x, n, context, peaks[0])), ...);
+				ptrOut[n] = x;
+			}
+			for (int32 l = 0; l < L; l++)
+				vuPPM = std::max (vuPPM, peaks[l]);
+		}
+	}
+	return vuPPM;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+SampleType runPipeline (SampleType** in, SampleType** out, int32 numChannels, int32 sampleFrames,
+                        int32 tileFrames, const PipelineContext& context)
+{
+	return runPipelineBody<SampleType, Stages...> (in, out, numChannels, sampleFrames, tileFrames,
+	                                               context);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+SampleType runMixPipeline (SampleType** in, SampleType** out, int32 numChannels,
+                           int32 sampleFrames, int32 tileFrames, const PipelineContext& context)
+{
+	return runMixPipelineBody<SampleType, Stages...> (in, out, numChannels, sampleFrames,
+	                                                  tileFrames, context);
+}
+
+//------------------------------------------------------------------------
+template <typename... Stages>
+Sample64 runFloatComputePipeline (Sample64** in, Sample64** out, int32 numChannels,
+                                  int32 sampleFrames, int32 tileFrames,
+                                  const PipelineContext& context)
+{
+	return runFloatComputeBody<Stages...> (in, out, numChannels, sampleFrames, tileFrames,
+	                                       context);
+}
+
+#if AGAIN_KERNEL_VARIANTS
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+AGAIN_TARGET ("avx2,fma")
+SampleType runPipelineAVX2 (SampleType** in, SampleType** out, int32 numChannels,
+                            int32 sampleFrames, int32 tileFrames, const PipelineContext& context)
+{
+	return runPipelineBody<SampleType, Stages...> (in, out, numChannels, sampleFrames, tileFrames,
+	                                               context);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+AGAIN_TARGET ("avx2,fma")
+SampleType runMixPipelineAVX2 (SampleType** in, SampleType** out, int32 numChannels,
+                               int32 sampleFrames, int32 tileFrames, const PipelineContext& context)
+{
+	return runMixPipelineBody<SampleType, Stages...> (in, out, numChannels, sampleFrames,
+	                                                  tileFrames, context);
+}
+
+//------------------------------------------------------------------------
+template <typename... Stages>
+AGAIN_TARGET ("avx2,fma")
+Sample64 runFloatComputePipelineAVX2 (Sample64** in, Sample64** out, int32 numChannels,
+                                      int32 sampleFrames, int32 tileFrames,
+                                      const PipelineContext& context)
+{
+	return runFloatComputeBody<Stages...> (in, out, numChannels, sampleFrames, tileFrames,
+	                                       context);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+AGAIN_TARGET ("avx512f")
+SampleType runPipelineAVX512 (SampleType** in, SampleType** out, int32 numChannels,
+                              int32 sampleFrames, int32 tileFrames, const PipelineContext& context)
+{
+	return runPipelineBody<SampleType, Stages...> (in, out, numChannels, sampleFrames, tileFrames,
+	                                               context);
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType, typename... Stages>
+AGAIN_TARGET ("avx512f")
+SampleType runMixPipelineAVX512 (SampleType** in, SampleType** out, int32 numChannels,
+                                 int32 sampleFrames, int32 tileFrames,
+                                 const PipelineContext& context)
+{
+	return runMixPipelineBody<SampleType, Stages...> (in, out, numChannels, sampleFrames,
+	                                                  tileFrames, context);
+}
+
+//------------------------------------------------------------------------
+template <typename... Stages>
+AGAIN_TARGET ("avx512f")
+Sample64 runFloatComputePipelineAVX512 (Sample64** in, Sample64** out, int32 numChannels,
+                                        int32 sampleFrames, int32 tileFrames,
+                                        const PipelineContext& context)
+{
+	return runFloatComputeBody<Stages...> (in, out, numChannels, sampleFrames, tileFrames,
+	                                       context);
+}
+#endif
+
+//------------------------------------------------------------------------
+// Runtime options, each combination is one pre-instantiated pipeline
+//------------------------------------------------------------------------
+enum PipelineFlags : uint32
+{
+	kPipelineBypass = 1 << 0, // no gain (wins over kPipelineFrameGains)
+	kPipelineFrameGains = 1 << 1, // gain of each frame instead of one gain
+	kPipelineSanitize = 1 << 2,
+	kPipelineAbsoluteMeter = 1 << 3,
+	kPipelineNoMeter = 1 << 4, // metering done by the AnalysisWorker (wins over AbsoluteMeter)
+	kPipelineMix = 1 << 5, // context.mix from the input to the output channels (see againmix.h)
+	kPipelineFloatCompute = 1 << 6, // Sample64 without kPipelineMix: the stages compute in float
+
+	kNumPipelines = 1 << 7
+};
+
+template <typename SampleType>
+using PipelineFunction = SampleType (*) (SampleType** in, SampleType** out, int32 numChannels,
+                                         int32 sampleFrames, int32 tileFrames,
+                                         const PipelineContext& context);
+
+//------------------------------------------------------------------------
+// the float computing pipeline of a Sample64 kPipelineFloatCompute combination, nullptr for all
+// others (float buffers ignore the flag, the mix always computes in SampleType)
+//------------------------------------------------------------------------
+template <typename SampleType, bool FloatCompute, int32 Variant, typename... Stages>
+struct FloatComputeFor
+{
+	static constexpr PipelineFunction<SampleType> function = nullptr;
+};
+
+template <int32 Variant, typename... Stages>
+struct FloatComputeFor<Sample64, true, Variant, Stages...>
+{
+#if AGAIN_KERNEL_VARIANTS
+	static constexpr PipelineFunction<Sample64> function =
+	    Variant == kKernelAVX512 ? &runFloatComputePipelineAVX512<Stages...> :
+	    Variant == kKernelAVX2   ? &runFloatComputePipelineAVX2<Stages...> :
+	                               &runFloatComputePipeline<Stages...>;
+#else
+	static constexpr PipelineFunction<Sample64> function = &runFloatComputePipeline<Stages...>;
+#endif
+};
+
+//------------------------------------------------------------------------
+template <typename SampleType, uint32 Flags, int32 Variant = kKernelGeneric>
+struct PipelineFor
+{
+	using Gain = typename std::conditional<
+	    (Flags & kPipelineBypass) != 0, IdentityStage,
+	    typename std::conditional<(Flags & kPipelineFrameGains) != 0, FrameGainStage,
+	                              GainStage>::type>::type;
+	using Sanitize =
+	    typename std::conditional<(Flags & kPipelineSanitize) != 0, SanitizeStage, NoStage>::type;
+	using Meter = typename std::conditional<
+	    (Flags & kPipelineNoMeter) != 0, NoStage,
+	    typename std::conditional<(Flags & kPipelineAbsoluteMeter) != 0, AbsolutePeakMeterStage,
+	                              PeakMeterStage>::type>::type;
+
+	static constexpr bool kMix = (Flags & kPipelineMix) != 0;
+	static constexpr bool kFloatCompute = (Flags & kPipelineFloatCompute) != 0;
+	using FloatCompute =
+	    FloatComputeFor<SampleType, kFloatCompute && !kMix, Variant, Gain, Sanitize, Meter>;
+
+#if AGAIN_KERNEL_VARIANTS
+	static constexpr PipelineFunction<SampleType> function =
+	    FloatCompute::function ? FloatCompute::function :
+	    Variant == kKernelAVX512 ?
+	        (kMix ? &runMixPipelineAVX512<SampleType, Gain, Sanitize, Meter> :
+	                &runPipelineAVX512<SampleType, Gain, Sanitize, Meter>) :
+	    Variant == kKernelAVX2 ? (kMix ? &runMixPipelineAVX2<SampleType, Gain, Sanitize, Meter> :
+	                                     &runPipelineAVX2<SampleType, Gain, Sanitize, Meter>) :
+	                             (kMix ? &runMixPipeline<SampleType, Gain, Sanitize, Meter> :
+	                                     &runPipeline<SampleType, Gain, Sanitize, Meter>);
+#else
+	static constexpr PipelineFunction<SampleType> function =
+	    FloatCompute::function ? FloatCompute::function :
+	    kMix                   ? &runMixPipeline<SampleType, Gain, Sanitize, Meter> :
+	                             &runPipeline<SampleType, Gain, Sanitize, Meter>;
+#endif
+};
+
+// one table per sample type and variant, built at compile time
+template <typename SampleType, int32 Variant, uint32... Flags>
+inline PipelineFunction<SampleType> getPipeline (uint32 flags,
+                                                 std::integer_sequence<uint32, Flags...>)
+{
+	static constexpr PipelineFunction<SampleType> table[] = {
+	    PipelineFor<SampleType, Flags, Variant>::function...};
+	return table[flags];
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+PipelineFunction<SampleType> getPipeline (uint32 flags, KernelVariant variant = kKernelGeneric)
+{
+	flags &= kNumPipelines - 1;
+	auto sequence = std::make_integer_sequence<uint32, kNumPipelines> ();
+	switch (variant)
+	{
+#if AGAIN_KERNEL_VARIANTS
+		case kKernelAVX2: return getPipeline<SampleType, kKernelAVX2> (flags, sequence);
+		case kKernelAVX512: return getPipeline<SampleType, kKernelAVX512> (flags, sequence);
+#endif
+		default: return getPipeline<SampleType, kKernelGeneric> (flags, sequence);
+	}
+}
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,190 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againprograms.h
+// Description : Factory programs of AGain and their sample accurate switching
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+#include "pluginterfaces/base/ustring.h"
+#include "pluginterfaces/vst/vsttypes.h"
+
+#include "againarena.h"
+#include "againenvelope.h"
+#include "againhotstate.h"
+#include "againparamids.h"
+#include "againparamsnapshot.h"
+#include "againsaturation.h"
+
+#include <algorithm>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// the program change parameter has the id of its program list (see ProgramList::getParameter)
+static constexpr ProgramListID kProgramListId = kProgramId;
+static constexpr int32 kNumPrograms = 8;
+
+//------------------------------------------------------------------------
+// ProgramTable: every program is compiled once per process into a ParameterSnapshot (normalized
+// values, the same structure setState hands to the audio thread), so selecting a program is an
+// index into this table: no stream, no parsing, no allocation.
+//------------------------------------------------------------------------
+struct ProgramTable
+{
+	String128 names[kNumPrograms];
+	ParameterSnapshot snapshots[kNumPrograms];
+};
+
+//------------------------------------------------------------------------
+inline const ProgramTable& getPrograms ()
+{
+	static const ProgramTable table = [] () {
+		struct Definition
+		{
+			const char* name;
+			float gain; // linear
+			int32 saturationMode;
+			float sidechainDepth;
+			double attackMs;
+			double releaseMs;
+		};
+		static const Definition definitions[kNumPrograms] = {
+		    {"Unity", 1.f, kSaturationOff, 0.5f, 10., 200.},
+		    {"-6 dB", 0.501f, kSaturationOff, 0.5f, 10., 200.},
+		    {"-12 dB", 0.251f, kSaturationOff, 0.5f, 10., 200.},
+		    {"Warm", 0.708f, kSaturation2x, 0.5f, 10., 200.},
+		    {"Drive", 1.f, kSaturation4x, 0.5f, 10., 200.},
+		    {"Duck", 1.f, kSaturationOff, 0.8f, 5., 300.},
+		    {"Fast Duck", 1.f, kSaturationOff, 1.f, 0.5, 50.},
+		    {"Silence", 0.f, kSaturationOff, 0.5f, 10., 200.},
+		};
+
+		ProgramTable table;
+		for (int32 i = 0; i < kNumPrograms; i++)
+		{
+			const Definition& definition = definitions[i];
+			UString (table.names[i], 128).fromAscii (definition.name);
+
+			// bypass, gain reduction (note on) and half gain are not part of a program
+			ParameterSnapshot& snapshot = table.snapshots[i];
+			snapshot.fields = ParameterSnapshot::kGain | ParameterSnapshot::kSaturationMode |
+			                  ParameterSnapshot::kSidechain;
+			snapshot.fGain = definition.gain;
+			snapshot.saturationMode = definition.saturationMode;
+			snapshot.fSidechainDepth = definition.sidechainDepth;
+			snapshot.fSidechainAttack =
+			    msToNormalized (definition.attackMs, kSidechainAttackMinMs, kSidechainAttackMaxMs);
+			snapshot.fSidechainRelease = msToNormalized (
+			    definition.releaseMs, kSidechainReleaseMinMs, kSidechainReleaseMaxMs);
+		}
+		return table;
+	}();
+	return table;
+}
+
+//------------------------------------------------------------------------
+inline int32 programFromNormalized (double value)
+{
+	int32 program = static_cast<int32> (value * (kNumPrograms - 1) + 0.5);
+	return std::min<int32> (std::max<int32> (program, 0), kNumPrograms - 1);
+}
+
+//------------------------------------------------------------------------
+// ProgramSwitch: applies a program in the audio thread at the sample offset of its program change.
+// The snapshot is applied to the hot state for the whole block (saturation and sidechain settings
+// can only change per block), the gain jump is hidden by a short linear fade: before the offset
+// the old gain is kept, then it moves to the new one in kFadeMs. The fade is written as the gain of
+// each frame (FrameGainStage), on top of the sidechain gains if there are any. Blocks which do not
+// run the gain (bypass, silence) end a fade.
+// Once other values were applied (setState, activation) no program is selected anymore: a
+// program change to the last one applies it again.
+//------------------------------------------------------------------------
+class ProgramSwitch
+{
+public:
+	static constexpr double kFadeMs = 5.;
+	static constexpr int32 kNoProgram = -1;
+
+	void setup (ProcessArena& arena, double sampleRate, int32 maxSamplesPerBlock)
+	{
+		maxFrames = std::max<int32> (maxSamplesPerBlock, 1);
+		fadeFrames = std::max<int32> ((int32) (kFadeMs * sampleRate / 1000.), 1);
+		gains = arena.allocate<float> (maxFrames);
+		reset ();
+	}
+
+	void reset ()
+	{
+		endFade ();
+		program = kNoProgram;
+	}
+
+	//--- audio thread ---
+	// after a snapshot of the mailbox was applied
+	void applied (const ParameterSnapshot& snapshot)
+	{
+		if (snapshot.fields & (ParameterSnapshot::kGain | ParameterSnapshot::kSaturationMode |
+		                       ParameterSnapshot::kSidechain))
+			program = kNoProgram;
+	}
+
+	void endFade ()
+	{
+		fadePosition = fadeFrames;
+		fadeStart = 0;
+	}
+
+	void select (int32 newProgram, int32 sampleOffset, AGainHotState& hot)
+	{
+		if (newProgram == program || newProgram < 0 || newProgram >= kNumPrograms)
+			return;
+		float fromGain = getBlockGain (hot);
+		getPrograms ().snapshots[newProgram].applyTo (hot);
+		if (gains)
+		{
+			gainOffset = fromGain - getBlockGain (hot);
+			fadeStart = std::max<int32> (sampleOffset, 0);
+			fadePosition = 0;
+		}
+		program = newProgram;
+	}
+
+	bool isFading () const { return fadePosition < fadeFrames; }
+	int32 getMaxFrames () const { return gains ? maxFrames : 0; }
+
+	// gain of each frame for this block: frameGains (sidechain) or gain, plus the fading offset
+	const float* process (const float* frameGains, float gain, int32 sampleFrames)
+	{
+		sampleFrames = std::min<int32> (sampleFrames, maxFrames);
+		const float step = gainOffset / (float)fadeFrames;
+		for (int32 n = 0; n < sampleFrames; n++)
+		{
+			float offset = 0.f;
+			if (n < fadeStart)
+				offset = gainOffset;
+			else if (fadePosition < fadeFrames)
+				offset = gainOffset - step * (float)++fadePosition;
+			gains[n] = std::max ((frameGains ? frameGains[n] : gain) + offset, 0.f);
+		}
+		fadeStart = 0; // a fade continued in the next block starts at its first frame
+		return gains;
+	}
+
+//------------------------------------------------------------------------
+private:
+	float* gains {nullptr};
+	int32 maxFrames {0};
+	int32 fadeFrames {1};
+	int32 fadeStart {0};
+	int32 fadePosition {1};
+	float gainOffset {0.f};
+	int32 program {kNoProgram};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
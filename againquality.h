@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againquality.h
+// Description : Quality tiers of AGain chosen from the process mode
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// kRealtime: cheapest kernels, no additional latency
+// kPrefetch: like realtime, but larger tiles (the host processes ahead, blocks are larger)
+// kOffline:  highest accuracy, CPU does not matter while bouncing. The only running sum is the
+//            sidechain envelope (double precision), the gain and the meter are per sample products
+//            and maxima without accumulation. No tier changes the sound: the saturation keeps the
+//            mode chosen by the user, the bounce sounds like the realtime mix
+//------------------------------------------------------------------------
+struct QualityOptions
+{
+	int32 tileScale {1}; // multiplies the cache derived tile size
+	bool doubleEnvelope {false}; // sidechain detector/envelope state in double precision
+	bool absolutePeakMetering {false}; // meter uses |x| (negative peaks too) on the output
+	bool sanitizeOutput {false}; // NaN, infinity and denormals are removed from the output
+	bool offloadAnalysis {false}; // meters computed by the AnalysisWorker (see againanalysis.h)
+	bool floatCompute {false}; // kSample64: gain pipelines compute in float (see againpipeline.h)
+	int32 reblockFrames {0}; // fixed internal block size, 0: host blocks (see againreblock.h)
+};
+
+// internal block sizes of the re-blocking (AGAIN_REBLOCK_FRAMES)
+static constexpr int32 kMinReblockFrames = 16;
+static constexpr int32 kMaxReblockFrames = 4096;
+
+//------------------------------------------------------------------------
+inline QualityOptions getQualityOptions (int32 processMode)
+{
+	QualityOptions options;
+	switch (processMode)
+	{
+		case kPrefetch:
+			options.tileScale = 4;
+			break;
+		case kOffline:
+			options.tileScale = 4;
+			options.doubleEnvelope = true;
+			options.absolutePeakMetering = true;
+			options.sanitizeOutput = true;
+			break;
+		default: // kRealtime or not yet known
+			break;
+	}
+	// AGAIN_SANITIZE=1 (or 0) switches the sanitizer on (off) in every tier
+	if (const char* env = getenv ("AGAIN_SANITIZE"))
+		options.sanitizeOutput = atoi (env) > 0;
+	// AGAIN_OFFLOAD_ANALYSIS=1 moves the metering out of the audio thread (worth it for very
+	// small blocks, where every pass over the buffers counts against the deadline)
+	if (const char* env = getenv ("AGAIN_OFFLOAD_ANALYSIS"))
+		options.offloadAnalysis = atoi (env) > 0;
+	// AGAIN_FLOAT_COMPUTE=1: 64 bit hosts get the gain and meter computed in float (error below
+	// 1.2e-7 relative) where the autotuner measures it faster, offline always keeps full double
+	// precision
+	if (const char* env = getenv ("AGAIN_FLOAT_COMPUTE"))
+		options.floatCompute = atoi (env) > 0 && processMode != kOffline;
+	// AGAIN_REBLOCK_FRAMES=64 (for example): the processing only sees full blocks of that size (a
+	// multiple of 16, so every vector kernel runs without remainder), for one block more latency
+	if (const char* env = getenv ("AGAIN_REBLOCK_FRAMES"))
+	{
+		int32 frames = atoi (env);
+		if (frames > 0)
+			options.reblockFrames =
+			    std::min (std::max ((frames + 15) & ~15, kMinReblockFrames), kMaxReblockFrames);
+	}
+	return options;
+}
+
+//------------------------------------------------------------------------
+// higher resolution metering: absolute peak, so negative half waves are taken into account
+template <typename SampleType>
+SampleType processVuPPMAbsolute (SampleType** in, int32 numChannels, int32 sampleFrames)
+{
+	SampleType vuPPM = 0;
+	for (int32 i = 0; i < numChannels; i++)
+	{
+		const SampleType* ptrIn = in[i];
+		for (int32 n = 0; n < sampleFrames; n++)
+			vuPPM = std::max<SampleType> (vuPPM, std::abs (ptrIn[n]));
+	}
+	return vuPPM;
+}
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,799 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againreblock.h
+// Description : Re-blocking of host blocks into fixed internal blocks or smaller parts
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+#include "pluginterfaces/vst/ivstaudioprocessor.h"
+#include "pluginterfaces/vst/ivstevents.h"
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+
+#include "againarena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Hosts may send irregular blocks (7, 93, 128, 1 frames...), then the vector kernels mostly run
+// their scalar remainders. With AGAIN_REBLOCK_FRAMES=<frames> (for example 64, see
+// getQualityOptions) the host blocks go through a FIFO instead and the processing only sees full,
+// cache line aligned blocks of that size:
+//
+//   host input  -> input block  (full: processed into the output block)
+//   host output <- output block (the result of the previous input block)
+//
+// Every frame waits exactly one internal block, which is the latency added to
+// getLatencySamples (the size is limited to kMinReblockFrames..kMaxReblockFrames, see
+// againquality.h). The parameter changes and events of a host block are queued with their
+// position in the stream and handed to the internal block which processes that position, with
+// the sample offset inside that block, so automation stays sample aligned with the audio. Calls
+// without audio (parameter flushes) are queued the same way: their changes can not overtake the
+// ones still waiting. Output parameter changes (the meter) of an internal block are written at the
+// frame of the host block where that block completed (see OffsetParameterChanges).
+//------------------------------------------------------------------------
+
+//------------------------------------------------------------------------
+// the queued input of one internal block as the VST interfaces the processing reads. These objects
+// belong to the Reblocker and are never reference counted.
+//------------------------------------------------------------------------
+class ReblockParamValueQueue : public IParamValueQueue
+{
+public:
+	struct Point
+	{
+		int32 sampleOffset;
+		ParamValue value;
+	};
+
+	ParamID PLUGIN_API getParameterId () SMTG_OVERRIDE { return id; }
+	int32 PLUGIN_API getPointCount () SMTG_OVERRIDE { return numPoints; }
+	tresult PLUGIN_API getPoint (int32 index, int32& sampleOffset, ParamValue& value) SMTG_OVERRIDE
+	{
+		if (index < 0 || index >= numPoints)
+			return kResultFalse;
+		sampleOffset = points[index].sampleOffset;
+		value = points[index].value;
+		return kResultTrue;
+	}
+	tresult PLUGIN_API addPoint (int32, ParamValue, int32&) SMTG_OVERRIDE { return kResultFalse; }
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+	ParamID id {kNoParamId};
+	const Point* points {nullptr};
+	int32 numPoints {0};
+};
+
+//------------------------------------------------------------------------
+class ReblockParameterChanges : public IParameterChanges
+{
+public:
+	static constexpr int32 kMaxQueues = 64; // different parameters changed in one internal block
+
+	int32 PLUGIN_API getParameterCount () SMTG_OVERRIDE { return numQueues; }
+	IParamValueQueue* PLUGIN_API getParameterData (int32 index) SMTG_OVERRIDE
+	{
+		return index >= 0 && index < numQueues ? &queues[index] : nullptr;
+	}
+	IParamValueQueue* PLUGIN_API addParameterData (const ParamID&, int32&) SMTG_OVERRIDE
+	{
+		return nullptr;
+	}
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+	ReblockParamValueQueue queues[kMaxQueues];
+	int32 numQueues {0};
+};
+
+//------------------------------------------------------------------------
+class ReblockEventList : public IEventList
+{
+public:
+	int32 PLUGIN_API getEventCount () SMTG_OVERRIDE { return numEvents; }
+	tresult PLUGIN_API getEvent (int32 index, Event& e) SMTG_OVERRIDE
+	{
+		if (index < 0 || index >= numEvents)
+			return kResultFalse;
+		e = events[index];
+		return kResultTrue;
+	}
+	tresult PLUGIN_API addEvent (Event&) SMTG_OVERRIDE { return kResultFalse; }
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+	const Event* events {nullptr};
+	int32 numEvents {0};
+};
+
+//------------------------------------------------------------------------
+// OffsetParameterChanges: the output parameter changes of a part of a host block. The points are
+// moved by the position of that part in the host block (limited to its frames), so several parts
+// never write the same sample offset of a queue. Views of the host's queues, nothing is copied.
+//------------------------------------------------------------------------
+class OffsetParamValueQueue : public IParamValueQueue
+{
+public:
+	ParamID PLUGIN_API getParameterId () SMTG_OVERRIDE { return host->getParameterId (); }
+	int32 PLUGIN_API getPointCount () SMTG_OVERRIDE { return host->getPointCount (); }
+	tresult PLUGIN_API getPoint (int32 index, int32& sampleOffset, ParamValue& value) SMTG_OVERRIDE
+	{
+		tresult result = host->getPoint (index, sampleOffset, value);
+		sampleOffset -= offset;
+		return result;
+	}
+	tresult PLUGIN_API addPoint (int32 sampleOffset, ParamValue value, int32& index) SMTG_OVERRIDE
+	{
+		int32 hostOffset = std::min (std::max (sampleOffset + offset, 0), lastFrame);
+		return host->addPoint (hostOffset, value, index);
+	}
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+	IParamValueQueue* host {nullptr};
+	int32 offset {0};
+	int32 lastFrame {0};
+};
+
+//------------------------------------------------------------------------
+class OffsetParameterChanges : public IParameterChanges
+{
+public:
+	static constexpr int32 kMaxQueues = 16; // output parameters (the meter)
+
+	// offset: position of the part in the host block of numSamples frames
+	void setup (IParameterChanges* hostChanges, int32 offset, int32 numSamples)
+	{
+		host = hostChanges;
+		partOffset = offset;
+		lastFrame = std::max (numSamples - 1, 0);
+		numQueues = 0;
+	}
+
+	int32 PLUGIN_API getParameterCount () SMTG_OVERRIDE { return host->getParameterCount (); }
+	IParamValueQueue* PLUGIN_API getParameterData (int32 index) SMTG_OVERRIDE
+	{
+		return wrap (host->getParameterData (index));
+	}
+	IParamValueQueue* PLUGIN_API addParameterData (const ParamID& id, int32& index) SMTG_OVERRIDE
+	{
+		return wrap (host->addParameterData (id, index));
+	}
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+//------------------------------------------------------------------------
+private:
+	IParamValueQueue* wrap (IParamValueQueue* hostQueue)
+	{
+		if (!hostQueue)
+			return nullptr;
+		for (int32 q = 0; q < numQueues; q++)
+			if (queues[q].host == hostQueue)
+				return &queues[q];
+		if (numQueues == kMaxQueues)
+			return nullptr;
+		OffsetParamValueQueue& queue = queues[numQueues++];
+		queue.host = hostQueue;
+		queue.offset = partOffset;
+		queue.lastFrame = lastFrame;
+		return &queue;
+	}
+
+	IParameterChanges* host {nullptr};
+	int32 partOffset {0};
+	int32 lastFrame {0};
+	OffsetParamValueQueue queues[kMaxQueues];
+	int32 numQueues {0};
+};
+
+//------------------------------------------------------------------------
+// Reblocker: the FIFO of the main input, the sidechain and the main output, plus the queued
+// parameter changes and events (audio thread only, reset by setActive)
+//------------------------------------------------------------------------
+class Reblocker
+{
+public:
+	static constexpr int32 kMaxBuses = 2; // main input and sidechain
+	static constexpr int32 kMaxChannels = 8;
+	static constexpr int32 kMaxChanges = 512; // parameter points waiting for their internal block
+	static constexpr int32 kMaxEvents = 512;
+
+	// blockFrames 0 switches the re-blocking off
+	void setup (ProcessArena& arena, int32 frames, int32 numMainChannels,
+	            int32 numSideChainChannels, int32 numOutChannels)
+	{
+		blockFrames = frames;
+		numChannels[0] = blockFrames > 0 ? std::min (numMainChannels, kMaxChannels) : 0;
+		numChannels[1] = blockFrames > 0 ? std::min (numSideChainChannels, kMaxChannels) : 0;
+		numOutputChannels = blockFrames > 0 ? std::min (numOutChannels, kMaxChannels) : 0;
+		// sized for 64 bit samples, the 32 bit ones use the first half
+		for (int32 b = 0; b < kMaxBuses; b++)
+			for (int32 i = 0; i < numChannels[b]; i++)
+				inputs[b][i] = arena.allocate<Sample64> (blockFrames);
+		for (int32 i = 0; i < numOutputChannels; i++)
+			outputs[i] = arena.allocate<Sample64> (blockFrames);
+		reset ();
+	}
+
+	bool isActive () const { return blockFrames > 0; }
+	int32 getLatencySamples () const { return blockFrames; }
+
+	// starts with one block of silence in the output (the latency)
+	void reset ()
+	{
+		for (int32 b = 0; b < kMaxBuses; b++)
+			for (int32 i = 0; i < numChannels[b]; i++)
+				if (inputs[b][i])
+					memset (inputs[b][i], 0, blockFrames * sizeof (Sample64));
+		for (int32 i = 0; i < numOutputChannels; i++)
+			if (outputs[i])
+				memset (outputs[i], 0, blockFrames * sizeof (Sample64));
+		position = 0;
+		streamPosition = 0;
+		blockStart = 0;
+		numChanges = 0;
+		numEvents = 0;
+	}
+
+	//--- audio thread ---
+	// a call without audio: its changes and events wait for the internal block at the current
+	// position of the stream
+	void queue (ProcessData& data)
+	{
+		queueInput (data);
+	}
+
+	// processBlock (ProcessData& block) is called for every full internal block
+	template <typename Func>
+	tresult process (ProcessData& data, Func&& processBlock)
+	{
+		queueInput (data);
+
+		const size_t sampleSize =
+		    data.symbolicSampleSize == kSample64 ? sizeof (Sample64) : sizeof (Sample32);
+		const int32 numBuses = std::min<int32> (data.numInputs, kMaxBuses);
+		const int32 numOut = std::min<int32> (data.outputs[0].numChannels, numOutputChannels);
+		tresult result = kResultOk;
+		int32 done = 0;
+		while (done < data.numSamples)
+		{
+			int32 count = std::min<int32> (data.numSamples - done, blockFrames - position);
+
+			// all inputs of this part first: the host buffers may be in place (in == out)
+			for (int32 b = 0; b < numBuses; b++)
+			{
+				int32 channels = std::min<int32> (data.inputs[b].numChannels, numChannels[b]);
+				void** host = (void**)data.inputs[b].channelBuffers32;
+				for (int32 i = 0; i < channels; i++)
+					memcpy ((char*)inputs[b][i] + position * sampleSize,
+					        (char*)host[i] + done * sampleSize, count * sampleSize);
+			}
+			void** hostOut = (void**)data.outputs[0].channelBuffers32;
+			for (int32 i = 0; i < numOut; i++)
+				memcpy ((char*)hostOut[i] + done * sampleSize,
+				        (char*)outputs[i] + position * sampleSize, count * sampleSize);
+
+			position += count;
+			done += count;
+			if (position == blockFrames)
+			{
+				tresult blockResult = runBlock (data, numBuses, numOut, done - 1, processBlock);
+				if (blockResult != kResultOk)
+					result = blockResult;
+				position = 0;
+			}
+		}
+		streamPosition += data.numSamples;
+
+		// the output mixes frames of several internal blocks
+		data.outputs[0].silenceFlags = 0;
+		return result;
+	}
+
+//------------------------------------------------------------------------
+private:
+	struct QueuedChange
+	{
+		ParamID id;
+		int64 position;
+		ParamValue value;
+	};
+
+	// the changes and events of a host block at their position in the stream
+	void queueInput (ProcessData& data)
+	{
+		if (IParameterChanges* paramChanges = data.inputParameterChanges)
+		{
+			int32 numParamsChanged = paramChanges->getParameterCount ();
+			for (int32 i = 0; i < numParamsChanged; i++)
+			{
+				IParamValueQueue* paramQueue = paramChanges->getParameterData (i);
+				if (!paramQueue)
+					continue;
+				ParamID id = paramQueue->getParameterId ();
+				int32 numPoints = paramQueue->getPointCount ();
+				for (int32 p = 0; p < numPoints; p++)
+				{
+					int32 sampleOffset;
+					ParamValue value;
+					if (paramQueue->getPoint (p, sampleOffset, value) == kResultTrue)
+						queueChange (id, streamPosition + std::max<int32> (sampleOffset, 0), value);
+				}
+			}
+		}
+		if (IEventList* eventList = data.inputEvents)
+		{
+			int32 count = eventList->getEventCount ();
+			for (int32 i = 0; i < count; i++)
+			{
+				Event event;
+				if (eventList->getEvent (i, event) == kResultOk)
+					queueEvent (event, streamPosition + std::max<int32> (event.sampleOffset, 0));
+			}
+		}
+	}
+
+	void queueEvent (const Event& event, int64 eventPosition)
+	{
+		// full (more than kMaxEvents within one internal block): the newest event replaces the
+		// last one, so the state the events leave behind (the gain reduction of the last note on
+		// or off) still arrives
+		int32 index = std::min (numEvents, kMaxEvents - 1);
+		events[index] = event;
+		eventPositions[index] = eventPosition;
+		numEvents = index + 1;
+	}
+
+	void queueChange (ParamID id, int64 changePosition, ParamValue value)
+	{
+		if (numChanges < kMaxChanges)
+		{
+			changes[numChanges++] = {id, changePosition, value};
+			return;
+		}
+		// full (more points than kMaxChanges within one internal block): the last point of the
+		// parameter moves, so at least its final value arrives
+		for (int32 i = numChanges - 1; i >= 0; i--)
+		{
+			if (changes[i].id == id)
+			{
+				changes[i] = {id, changePosition, value};
+				return;
+			}
+		}
+	}
+
+	// completedAt: the frame of the host block with the last input frame of this block
+	template <typename Func>
+	tresult runBlock (ProcessData& data, int32 numBuses, int32 numOut, int32 completedAt,
+	                  Func&& processBlock)
+	{
+		const int64 blockEnd = blockStart + blockFrames;
+		buildParameterChanges (blockEnd);
+		buildEvents (blockEnd);
+
+		AudioBusBuffers blockInputs[kMaxBuses] {};
+		for (int32 b = 0; b < numBuses; b++)
+		{
+			blockInputs[b].numChannels = std::min<int32> (data.inputs[b].numChannels, numChannels[b]);
+			blockInputs[b].channelBuffers32 = (Sample32**)inputs[b];
+		}
+		AudioBusBuffers blockOutputs {};
+		blockOutputs.numChannels = numOut;
+		blockOutputs.channelBuffers32 = (Sample32**)outputs;
+
+		ProcessData block = data;
+		block.numSamples = blockFrames;
+		block.numInputs = numBuses;
+		block.inputs = blockInputs;
+		block.numOutputs = 1;
+		block.outputs = &blockOutputs;
+		block.inputParameterChanges = &blockChanges;
+		block.inputEvents = &blockEvents;
+		if (data.outputParameterChanges)
+		{
+			// several internal blocks of one host block never write the same sample offset
+			blockOutputChanges.setup (data.outputParameterChanges, completedAt, data.numSamples);
+			block.outputParameterChanges = &blockOutputChanges;
+		}
+		tresult result = processBlock (block);
+
+		removeQueued (blockEnd);
+		blockStart = blockEnd;
+		return result;
+	}
+
+	// one queue per parameter with its points of this block (in the order they arrived)
+	void buildParameterChanges (int64 blockEnd)
+	{
+		auto findQueue = [&] (ParamID id) {
+			for (int32 q = 0; q < blockChanges.numQueues; q++)
+				if (blockChanges.queues[q].id == id)
+					return q;
+			return -1;
+		};
+
+		// first the number of points of each queue, then the points
+		blockChanges.numQueues = 0;
+		int32 sizes[ReblockParameterChanges::kMaxQueues];
+		for (int32 i = 0; i < numChanges; i++)
+		{
+			if (changes[i].position >= blockEnd)
+				continue;
+			int32 q = findQueue (changes[i].id);
+			if (q < 0)
+			{
+				if (blockChanges.numQueues == ReblockParameterChanges::kMaxQueues)
+					continue;
+				q = blockChanges.numQueues++;
+				blockChanges.queues[q].id = changes[i].id;
+				sizes[q] = 0;
+			}
+			sizes[q]++;
+		}
+		int32 first = 0;
+		for (int32 q = 0; q < blockChanges.numQueues; q++)
+		{
+			blockChanges.queues[q].points = points + first;
+			blockChanges.queues[q].numPoints = 0;
+			first += sizes[q];
+		}
+		for (int32 i = 0; i < numChanges; i++)
+		{
+			if (changes[i].position >= blockEnd)
+				continue;
+			int32 q = findQueue (changes[i].id);
+			if (q < 0)
+				continue;
+			ReblockParamValueQueue& queue = blockChanges.queues[q];
+			points[queue.points - points + queue.numPoints++] = {
+			    (int32)std::max<int64> (changes[i].position - blockStart, 0), changes[i].value};
+		}
+	}
+
+	void buildEvents (int64 blockEnd)
+	{
+		blockEvents.events = blockEventData;
+		blockEvents.numEvents = 0;
+		for (int32 i = 0; i < numEvents; i++)
+		{
+			if (eventPositions[i] >= blockEnd)
+				continue;
+			Event& e = blockEventData[blockEvents.numEvents++];
+			e = events[i];
+			e.sampleOffset = (int32)std::max<int64> (eventPositions[i] - blockStart, 0);
+		}
+	}
+
+	// keeps what belongs to the next internal blocks
+	void removeQueued (int64 blockEnd)
+	{
+		int32 kept = 0;
+		for (int32 i = 0; i < numChanges; i++)
+			if (changes[i].position >= blockEnd)
+				changes[kept++] = changes[i];
+		numChanges = kept;
+
+		kept = 0;
+		for (int32 i = 0; i < numEvents; i++)
+		{
+			if (eventPositions[i] >= blockEnd)
+			{
+				events[kept] = events[i];
+				eventPositions[kept++] = eventPositions[i];
+			}
+		}
+		numEvents = kept;
+	}
+
+	int32 blockFrames {0};
+	int32 numChannels[kMaxBuses] {};
+	int32 numOutputChannels {0};
+	Sample64* inputs[kMaxBuses][kMaxChannels] {};
+	Sample64* outputs[kMaxChannels] {};
+
+	int32 position {0}; // in the current internal block
+	int64 streamPosition {0}; // of the first frame of the next host block
+	int64 blockStart {0}; // stream position of the current internal block
+
+	QueuedChange changes[kMaxChanges];
+	int32 numChanges {0};
+	Event events[kMaxEvents];
+	int64 eventPositions[kMaxEvents];
+	int32 numEvents {0};
+
+	ReblockParameterChanges blockChanges;
+	ReblockParamValueQueue::Point points[kMaxChanges];
+	ReblockEventList blockEvents;
+	Event blockEventData[kMaxEvents];
+	OffsetParameterChanges blockOutputChanges;
+};
+
+//------------------------------------------------------------------------
+// BlockSplitter: a host block larger than the maxSamplesPerBlock of setupProcessing (which all
+// buffers of the processing are sized for) is processed in parts of at most that size, without
+// any latency. Each part sees the parameter points and events of its frames, with the sample
+// offsets relative to the part (offsets outside the host block count for its first or last
+// frame), and its output parameter points are moved to the frames of the part.
+//------------------------------------------------------------------------
+class WindowParamValueQueue : public IParamValueQueue
+{
+public:
+	ParamID PLUGIN_API getParameterId () SMTG_OVERRIDE { return host->getParameterId (); }
+	int32 PLUGIN_API getPointCount () SMTG_OVERRIDE
+	{
+		int32 count = 0;
+		int32 numPoints = host->getPointCount ();
+		for (int32 p = 0; p < numPoints; p++)
+		{
+			int32 sampleOffset;
+			ParamValue value;
+			if (host->getPoint (p, sampleOffset, value) == kResultTrue && contains (sampleOffset))
+				count++;
+		}
+		return count;
+	}
+	tresult PLUGIN_API getPoint (int32 index, int32& sampleOffset, ParamValue& value) SMTG_OVERRIDE
+	{
+		if (index < 0)
+			return kResultFalse;
+		int32 numPoints = host->getPointCount ();
+		for (int32 p = 0; p < numPoints; p++)
+		{
+			if (host->getPoint (p, sampleOffset, value) != kResultTrue || !contains (sampleOffset))
+				continue;
+			if (index-- == 0)
+			{
+				sampleOffset = std::max (sampleOffset - start, 0);
+				return kResultTrue;
+			}
+		}
+		return kResultFalse;
+	}
+	tresult PLUGIN_API addPoint (int32, ParamValue, int32&) SMTG_OVERRIDE { return kResultFalse; }
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+	bool contains (int32 sampleOffset) const
+	{
+		sampleOffset = std::min (std::max (sampleOffset, 0), lastFrame);
+		return sampleOffset >= start && sampleOffset < end;
+	}
+
+	IParamValueQueue* host {nullptr};
+	int32 start {0};
+	int32 end {0};
+	int32 lastFrame {0};
+};
+
+//------------------------------------------------------------------------
+class WindowParameterChanges : public IParameterChanges
+{
+public:
+	static constexpr int32 kMaxQueues = 64;
+
+	int32 PLUGIN_API getParameterCount () SMTG_OVERRIDE
+	{
+		return std::min (host->getParameterCount (), kMaxQueues);
+	}
+	IParamValueQueue* PLUGIN_API getParameterData (int32 index) SMTG_OVERRIDE
+	{
+		if (index < 0 || index >= kMaxQueues)
+			return nullptr;
+		IParamValueQueue* hostQueue = host->getParameterData (index);
+		if (!hostQueue)
+			return nullptr;
+		WindowParamValueQueue& queue = queues[index];
+		queue.host = hostQueue;
+		queue.start = start;
+		queue.end = end;
+		queue.lastFrame = lastFrame;
+		return &queue;
+	}
+	IParamValueQueue* PLUGIN_API addParameterData (const ParamID&, int32&) SMTG_OVERRIDE
+	{
+		return nullptr;
+	}
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+	IParameterChanges* host {nullptr};
+	int32 start {0};
+	int32 end {0};
+	int32 lastFrame {0};
+	WindowParamValueQueue queues[kMaxQueues];
+};
+
+//------------------------------------------------------------------------
+class WindowEventList : public IEventList
+{
+public:
+	int32 PLUGIN_API getEventCount () SMTG_OVERRIDE
+	{
+		int32 count = 0;
+		int32 numEvents = host->getEventCount ();
+		for (int32 i = 0; i < numEvents; i++)
+		{
+			Event e;
+			if (host->getEvent (i, e) == kResultOk && contains (e.sampleOffset))
+				count++;
+		}
+		return count;
+	}
+	tresult PLUGIN_API getEvent (int32 index, Event& e) SMTG_OVERRIDE
+	{
+		if (index < 0)
+			return kResultFalse;
+		int32 numEvents = host->getEventCount ();
+		for (int32 i = 0; i < numEvents; i++)
+		{
+			if (host->getEvent (i, e) != kResultOk || !contains (e.sampleOffset))
+				continue;
+			if (index-- == 0)
+			{
+				e.sampleOffset = std::max (e.sampleOffset - start, 0);
+				return kResultOk;
+			}
+		}
+		return kResultFalse;
+	}
+	tresult PLUGIN_API addEvent (Event&) SMTG_OVERRIDE { return kResultFalse; }
+
+	tresult PLUGIN_API queryInterface (const TUID, void** obj) SMTG_OVERRIDE
+	{
+		*obj = nullptr;
+		return kNoInterface;
+	}
+	uint32 PLUGIN_API addRef () SMTG_OVERRIDE { return 1; }
+	uint32 PLUGIN_API release () SMTG_OVERRIDE { return 1; }
+
+	bool contains (int32 sampleOffset) const
+	{
+		sampleOffset = std::min (std::max (sampleOffset, 0), lastFrame);
+		return sampleOffset >= start && sampleOffset < end;
+	}
+
+	IEventList* host {nullptr};
+	int32 start {0};
+	int32 end {0};
+	int32 lastFrame {0};
+};
+
+//------------------------------------------------------------------------
+class BlockSplitter
+{
+public:
+	static constexpr int32 kMaxBuses = 2; // main input and sidechain
+	static constexpr int32 kMaxChannels = 8;
+
+	//--- audio thread ---
+	// processBlock (ProcessData& part) is called for every part of at most maxFrames frames
+	template <typename Func>
+	tresult process (ProcessData& data, int32 maxFrames, Func&& processBlock)
+	{
+		const size_t sampleSize =
+		    data.symbolicSampleSize == kSample64 ? sizeof (Sample64) : sizeof (Sample32);
+		const int32 numBuses = std::min<int32> (data.numInputs, kMaxBuses);
+		const int32 lastFrame = std::max (data.numSamples - 1, 0);
+		uint64 outputSilence = ~(uint64)0;
+		tresult result = kResultOk;
+		for (int32 start = 0; start < data.numSamples; start += maxFrames)
+		{
+			int32 count = std::min (data.numSamples - start, maxFrames);
+
+			AudioBusBuffers partInputs[kMaxBuses] {};
+			for (int32 b = 0; b < numBuses; b++)
+				partInputs[b] = offsetBus (data.inputs[b], inputs[b], start, sampleSize);
+			AudioBusBuffers partOutput = offsetBus (data.outputs[0], outputs, start, sampleSize);
+
+			ProcessData part = data;
+			part.numSamples = count;
+			part.numInputs = numBuses;
+			part.inputs = partInputs;
+			part.numOutputs = 1;
+			part.outputs = &partOutput;
+			if (data.inputParameterChanges)
+			{
+				inputChanges.host = data.inputParameterChanges;
+				inputChanges.start = start;
+				inputChanges.end = start + count;
+				inputChanges.lastFrame = lastFrame;
+				part.inputParameterChanges = &inputChanges;
+			}
+			if (data.inputEvents)
+			{
+				inputEvents.host = data.inputEvents;
+				inputEvents.start = start;
+				inputEvents.end = start + count;
+				inputEvents.lastFrame = lastFrame;
+				part.inputEvents = &inputEvents;
+			}
+			if (data.outputParameterChanges)
+			{
+				outputChanges.setup (data.outputParameterChanges, start, data.numSamples);
+				part.outputParameterChanges = &outputChanges;
+			}
+
+			tresult partResult = processBlock (part);
+			if (partResult != kResultOk)
+				result = partResult;
+			outputSilence &= partOutput.silenceFlags;
+		}
+		data.outputs[0].silenceFlags = outputSilence;
+		return result;
+	}
+
+//------------------------------------------------------------------------
+private:
+	AudioBusBuffers offsetBus (const AudioBusBuffers& bus, void** channels, int32 start,
+	                           size_t sampleSize)
+	{
+		AudioBusBuffers part = bus;
+		part.numChannels = std::min<int32> (bus.numChannels, kMaxChannels);
+		void** host = (void**)bus.channelBuffers32;
+		for (int32 i = 0; i < part.numChannels; i++)
+			channels[i] = (char*)host[i] + start * sampleSize;
+		part.channelBuffers32 = (Sample32**)channels;
+		return part;
+	}
+
+	void* inputs[kMaxBuses][kMaxChannels] {};
+	void* outputs[kMaxChannels] {};
+	WindowParameterChanges inputChanges;
+	WindowEventList inputEvents;
+	OffsetParameterChanges outputChanges;
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,317 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againreblocktest.cpp
+// Description : Test of the Reblocker (AGAIN_REBLOCK_FRAMES) against its stream positions
+//-----------------------------------------------------------------------------
+#include "againreblock.h"
+
+#include "public.sdk/source/vst/hosting/eventlist.h"
+#include "public.sdk/source/vst/hosting/parameterchanges.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+//------------------------------------------------------------------------
+// stream: random host blocks of 0..149 frames (in place buffers) with parameter points and note
+//         events at random offsets go through internal blocks of kBlockFrames, which double the
+//         input. The output has to be the input delayed by exactly one internal block, every
+//         internal block full and cache line aligned, and every point and event has to arrive in
+//         order at its position in the stream (internal block * kBlockFrames + sample offset).
+// flush:  a point waiting for the next internal block is not overtaken by a newer one of a call
+//         without audio, the meter of the internal blocks completed in one host block is written
+//         at increasing offsets, and more events than the queue holds are dropped (not
+//         overwritten).
+// Returns 0 when every check passed.
+//------------------------------------------------------------------------
+static constexpr int32 kBlockFrames = 64;
+static constexpr int32 kNumChannels = 2;
+static constexpr int64 kStreamFrames = 20000;
+static constexpr ParamID kTestParamId = 7;
+
+//------------------------------------------------------------------------
+struct StreamItem
+{
+	int64 position;
+	ParamValue value; // the noteId for events
+	bool operator== (const StreamItem& other) const
+	{
+		return position == other.position && value == other.value;
+	}
+};
+
+//------------------------------------------------------------------------
+static void setupReblocker (ProcessArena& arena, Reblocker& reblocker)
+{
+	arena.beginMeasure ();
+	reblocker.setup (arena, kBlockFrames, kNumChannels, 0, kNumChannels);
+	arena.commit (false);
+	reblocker.setup (arena, kBlockFrames, kNumChannels, 0, kNumChannels);
+}
+
+//------------------------------------------------------------------------
+// items in the order they were sent, the received ones have to be the same up to the last
+// processed position
+static int32 compareItems (const std::vector<StreamItem>& sent,
+                           const std::vector<StreamItem>& received, int64 processedFrames)
+{
+	int32 failures = 0;
+	size_t numSent = 0;
+	while (numSent < sent.size () && sent[numSent].position < processedFrames)
+		numSent++;
+	if (received.size () != numSent)
+		failures++;
+	for (size_t i = 0; i < std::min (numSent, received.size ()); i++)
+	{
+		if (!(received[i] == sent[i]))
+			failures++;
+	}
+	return failures;
+}
+
+//------------------------------------------------------------------------
+template <typename SampleType>
+static int32 testStream (int32 symbolicSampleSize)
+{
+	ProcessArena arena;
+	Reblocker reblocker;
+	setupReblocker (arena, reblocker);
+
+	std::mt19937 random (symbolicSampleSize + 1);
+	std::vector<SampleType> input (kStreamFrames);
+	for (int64 i = 0; i < kStreamFrames; i++)
+		input[i] = (SampleType)std::sin (i * 0.01);
+	std::vector<SampleType> output;
+	output.reserve (kStreamFrames);
+
+	std::vector<StreamItem> sentChanges, sentEvents, receivedChanges, receivedEvents;
+	int32 failures = 0;
+	int64 numBlocks = 0;
+	auto processBlock = [&] (ProcessData& block) {
+		if (block.numSamples != kBlockFrames)
+			failures++;
+		SampleType** in = (SampleType**)block.inputs[0].channelBuffers32;
+		SampleType** out = (SampleType**)block.outputs[0].channelBuffers32;
+		for (int32 c = 0; c < kNumChannels; c++)
+		{
+			if ((uintptr_t)in[c] % 64 != 0 || (uintptr_t)out[c] % 64 != 0)
+				failures++;
+			for (int32 n = 0; n < kBlockFrames; n++)
+				out[c][n] = in[c][n] * 2;
+		}
+
+		int64 blockStart = numBlocks * kBlockFrames;
+		IParameterChanges* changes = block.inputParameterChanges;
+		for (int32 i = 0; i < changes->getParameterCount (); i++)
+		{
+			IParamValueQueue* queue = changes->getParameterData (i);
+			for (int32 p = 0; p < queue->getPointCount (); p++)
+			{
+				int32 sampleOffset;
+				ParamValue value;
+				if (queue->getPoint (p, sampleOffset, value) == kResultTrue)
+					receivedChanges.push_back ({blockStart + sampleOffset, value});
+			}
+		}
+		IEventList* events = block.inputEvents;
+		for (int32 i = 0; i < events->getEventCount (); i++)
+		{
+			Event event;
+			if (events->getEvent (i, event) == kResultOk)
+				receivedEvents.push_back ({blockStart + event.sampleOffset,
+				                           (ParamValue)event.noteOn.noteId});
+		}
+		numBlocks++;
+		return kResultOk;
+	};
+
+	int64 position = 0;
+	while (position < kStreamFrames)
+	{
+		int32 numSamples = (int32)std::min<int64> (random () % 150, kStreamFrames - position);
+
+		// in place, as many hosts do
+		std::vector<SampleType> channels[kNumChannels];
+		SampleType* buffers[kNumChannels];
+		for (int32 c = 0; c < kNumChannels; c++)
+		{
+			channels[c].assign (input.begin () + position,
+			                    input.begin () + position + numSamples);
+			buffers[c] = channels[c].data ();
+		}
+		AudioBusBuffers bus {};
+		bus.numChannels = kNumChannels;
+		bus.channelBuffers32 = (Sample32**)buffers;
+
+		ParameterChanges changes;
+		EventList events;
+		if (numSamples > 0 && random () % 3 == 0)
+		{
+			int32 sampleOffset = (int32)(random () % numSamples);
+			ParamValue value = (double)(sentChanges.size () + 1) / 1000.;
+			int32 index;
+			changes.addParameterData (kTestParamId, index)->addPoint (sampleOffset, value, index);
+			sentChanges.push_back ({position + sampleOffset, value});
+
+			Event event {};
+			event.type = Event::kNoteOnEvent;
+			event.sampleOffset = (int32)(random () % numSamples);
+			event.noteOn.noteId = (int32)sentEvents.size ();
+			events.addEvent (event);
+			sentEvents.push_back ({position + event.sampleOffset, (ParamValue)event.noteOn.noteId});
+		}
+
+		ProcessData data {};
+		data.symbolicSampleSize = symbolicSampleSize;
+		data.numSamples = numSamples;
+		data.numInputs = 1;
+		data.numOutputs = 1;
+		data.inputs = &bus;
+		data.outputs = &bus;
+		data.inputParameterChanges = &changes;
+		data.inputEvents = &events;
+		reblocker.process (data, processBlock);
+
+		output.insert (output.end (), channels[0].begin (), channels[0].end ());
+		position += numSamples;
+	}
+
+	// the input delayed by one internal block (silence before)
+	double maxError = 0.;
+	for (int64 i = 0; i < kStreamFrames; i++)
+	{
+		SampleType expected = i < kBlockFrames ? 0 : input[i - kBlockFrames] * 2;
+		maxError = std::max (maxError, (double)std::abs (output[i] - expected));
+	}
+	if (maxError != 0.)
+		failures++;
+
+	int64 processedFrames = numBlocks * kBlockFrames;
+	failures += compareItems (sentChanges, receivedChanges, processedFrames);
+	failures += compareItems (sentEvents, receivedEvents, processedFrames);
+
+	fprintf (stderr,
+	         "[againreblocktest] stream %s: %lld blocks, %zu points, %zu events, max error %g, %d "
+	         "failures\n",
+	         symbolicSampleSize == kSample64 ? "64 bit" : "32 bit", (long long)numBlocks,
+	         receivedChanges.size (), receivedEvents.size (), maxError, failures);
+	return failures;
+}
+
+//------------------------------------------------------------------------
+static int32 testFlush ()
+{
+	ProcessArena arena;
+	Reblocker reblocker;
+	setupReblocker (arena, reblocker);
+
+	ParamValue lastValue = 0.;
+	int32 numEvents = 0;
+	auto processBlock = [&] (ProcessData& block) {
+		IParameterChanges* changes = block.inputParameterChanges;
+		for (int32 i = 0; i < changes->getParameterCount (); i++)
+		{
+			IParamValueQueue* queue = changes->getParameterData (i);
+			int32 sampleOffset;
+			queue->getPoint (queue->getPointCount () - 1, sampleOffset, lastValue);
+		}
+		numEvents += block.inputEvents->getEventCount ();
+		// the meter of this internal block
+		if (IParameterChanges* outChanges = block.outputParameterChanges)
+		{
+			int32 index;
+			if (IParamValueQueue* queue = outChanges->addParameterData (kTestParamId, index))
+				queue->addPoint (0, 1., index);
+		}
+		return kResultOk;
+	};
+
+	std::vector<Sample32> left (200), right (200);
+	Sample32* buffers[kNumChannels] = {left.data (), right.data ()};
+	AudioBusBuffers bus {};
+	bus.numChannels = kNumChannels;
+	bus.channelBuffers32 = buffers;
+	ProcessData data {};
+	data.symbolicSampleSize = kSample32;
+	data.numInputs = 1;
+	data.numOutputs = 1;
+	data.inputs = &bus;
+	data.outputs = &bus;
+
+	int32 failures = 0;
+	int32 index;
+
+	// 200 frames: the internal blocks complete at 63, 127 and 191, the point at 190 waits for the
+	// block starting at 192
+	{
+		ParameterChanges changes;
+		changes.addParameterData (1, index)->addPoint (190, 0.1, index);
+		EventList events;
+		ParameterChanges outChanges;
+		data.numSamples = 200;
+		data.inputParameterChanges = &changes;
+		data.inputEvents = &events;
+		data.outputParameterChanges = &outChanges;
+		reblocker.process (data, processBlock);
+
+		IParamValueQueue* meter = outChanges.getParameterData (0);
+		int32 sampleOffsets[3] = {};
+		ParamValue value;
+		for (int32 p = 0; meter && p < std::min (meter->getPointCount (), 3); p++)
+			meter->getPoint (p, sampleOffsets[p], value);
+		if (!meter || meter->getPointCount () != 3 || sampleOffsets[0] != 63 ||
+		    sampleOffsets[1] != 127 || sampleOffsets[2] != 191)
+			failures++;
+	}
+
+	// a flush (no audio) with a newer value, it has to come after the waiting one
+	{
+		ParameterChanges changes;
+		changes.addParameterData (1, index)->addPoint (0, 0.9, index);
+		EventList events;
+		ProcessData flush {};
+		flush.inputParameterChanges = &changes;
+		flush.inputEvents = &events;
+		reblocker.queue (flush);
+	}
+
+	// more events than the queue holds
+	{
+		ParameterChanges changes;
+		EventList events (1000);
+		for (int32 i = 0; i < 1000; i++)
+		{
+			Event event {};
+			event.type = Event::kNoteOnEvent;
+			event.sampleOffset = i % 100;
+			events.addEvent (event);
+		}
+		ParameterChanges outChanges;
+		data.inputParameterChanges = &changes;
+		data.inputEvents = &events;
+		data.outputParameterChanges = &outChanges;
+		reblocker.process (data, processBlock);
+	}
+
+	if (lastValue != 0.9 || numEvents != Reblocker::kMaxEvents)
+		failures++;
+	fprintf (stderr, "[againreblocktest] flush: last value %g, %d events, %d failures\n", lastValue,
+	         numEvents, failures);
+	return failures;
+}
+
+//------------------------------------------------------------------------
+int main ()
+{
+	int32 failures = testStream<Sample32> (kSample32);
+	failures += testStream<Sample64> (kSample64);
+	failures += testFlush ();
+	return failures == 0 ? 0 : 1;
+}
@@ -9,30 +9,74 @@
 #include "again.h"
 #include "againcids.h" // for class ids
 #include "againparamids.h"
+#include "againanalysis.h"
+#include "againarena.h"
+#include "againautotune.h"
+#include "againconvolution.h"
+#include "againenvelope.h"
+#include "againhotstate.h"
+#include "againmetadata.h"
+#include "againmeterdemand.h"
+#include "againmidilearn.h"
+#include "againmix.h"
+#include "againparamsnapshot.h"
+#include "againperfcounters.h"
+#include "againpipeline.h"
 #include "againprocess.h"
+#include "againprograms.h"
+#include "againquality.h"
+#include "againreblock.h"
+#include "againsaturation.h"
+#include "againsharedmemory.h"
+#include "againsmallblock.h"
+#include "againstatemodel.h"
+#include "againtiling.h"
 
 #include "public.sdk/source/vst/vstaudioprocessoralgo.h"
-#include "public.sdk/source/vst/vsthelpers.h"
 
 #include "pluginterfaces/base/ibstream.h"
 #include "pluginterfaces/base/ustring.h" // for UString128
 #include "pluginterfaces/vst/ivstevents.h"
 #include "pluginterfaces/vst/ivstparameterchanges.h"
-#include "pluginterfaces/vst/vstpresetkeys.h" // for use of IStreamAttributes
 
 #include "base/source/fstreamer.h"
 
+#include <cassert>
 #include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+
+#if AGAIN_ASSERT_NO_ALLOCATIONS
+//------------------------------------------------------------------------
+// Debug only: operator new of this module fails inside process () (see againarena.h)
+//------------------------------------------------------------------------
+void* operator new (std::size_t size)
+{
+	assert (!Steinberg::Vst::noAllocationScope () && "heap allocation in the audio thread");
+	if (void* ptr = std::malloc (size ? size : 1))
+		return ptr;
+	throw std::bad_alloc ();
+}
+
+void operator delete (void* ptr) noexcept
+{
+	std::free (ptr);
+}
+
+void operator delete (void* ptr, std::size_t) noexcept
+{
+	std::free (ptr);
+}
+#endif
 
 namespace Steinberg {
 namespace Vst {
 
 // AGain constructor
 AGain::AGain()
-    : fGain(1.f) //->Initial value for the gain parameter (default gain = 1.0)
-    , fGainReduction(0.f) //->Initial value for the gain reduction parameter (default gain reduction = 0.0)
-    , fVuPPMOld(0.f) //->Initial value for the old VU meter value (default VU meter = 0.0)
-    , currentProcessMode(-1) //-> -1 means not initialized
+    : currentProcessMode(-1) //-> -1 means not initialized
+    //-> The initial values of gain, gain reduction, VU meter,... are set in AGainHotState
 {
     //-> Register the editor class for the plugin (the same as used in againentry.cpp)
     setControllerClass(AGainControllerUID);
@@ -55,13 +99,10 @@ tresult PLUGIN_API AGain::initialize(FUnknown* context)
         return result;
     }
 
-    //-> Create Audio In/Out busses
-    //-> We want a stereo Input and a Stereo Output
-    addAudioInput(STR16("Stereo In"), SpeakerArr::kStereo);
-    addAudioOutput(STR16("Stereo Out"), SpeakerArr::kStereo);
-
-    //-> Create Event In/Out busses (1 bus with only 1 channel)
-    addEventInput(STR16("Event In"), 1);
+    //-> Create Audio In/Out busses from the metadata shared with the scan export (see
+    //-> againmetadata.h): a stereo Input and a Stereo Output, the optional sidechain input (aux
+    //-> bus, not active by default) driving the gain reduction and 1 Event In bus with 16 channels
+    addBussesTo(*this, getAGainMetadata());
 
     return kResultOk;
 }
@@ -69,7 +110,13 @@ tresult PLUGIN_API AGain::initialize(FUnknown* context)
 //-> AGain terminate function
 tresult PLUGIN_API AGain::terminate()
 {
-    //-> Nothing to do here yet... except calling our parent terminate
+    //-> Release the impulse responses and the shared memory regions (no process call anymore)
+    convolution.reset(convolutionKernels);
+    convolutionKernels.clear();
+    sharedTable = nullptr;
+    sharedData.clear();
+
+    //-> Call our parent terminate
     return AudioEffect::terminate();
 }
 
@@ -80,15 +127,59 @@ tresult PLUGIN_API AGain::setActive(TBool state)
     {
         //-> Send a text message to indicate that the plugin is set to active (true)
         sendTextMessage("AGain::setActive (true)");
+
+        //-> Start the sidechain detector from silence
+        envelope.reset();
+        programSwitch.reset();
+
+        //-> Per block settings which only change with parameters, process () updates them only in
+        //-> blocks with changes (see againsmallblock.h)
+        saturation.setMode(hot.saturationMode);
+        envelope.setTimes(hot.fSidechainAttack, hot.fSidechainRelease);
+
+        //-> Busses are only activated while we are inactive
+        AudioBus* sideChainBus = getAudioInput(1);
+        hot.bSideChainActive = sideChainBus && sideChainBus->isActive();
+        EventBus* eventBus = getEventInput(0);
+        hot.bEventInputActive = eventBus && eventBus->isActive();
+
+        //-> Optional metering outside the audio thread (see againanalysis.h)
+        if (hot.quality.offloadAnalysis)
+        {
+            analysisWorker.start(analysisRing, hot.quality.absolutePeakMetering);
+        }
     }
     else
     {
         //-> Send a text message to indicate that the plugin is set to inactive (false)
         sendTextMessage("AGain::setActive (false)");
+
+        //-> Instrumented runs print what the hardware counters measured while we were active
+        if (perfCounters.isEnabled())
+        {
+            perfCounters.report(stderr);
+        }
+
+        analysisWorker.stop();
     }
 
     //-> Reset the VU Meter value to 0
-    fVuPPMOld = 0.f;
+    hot.fVuPPMOld = 0.f;
+    meterThrottle.reset();
+
+    //-> The re-blocking FIFO starts with one block of silence (its latency)
+    reblocker.reset();
+
+    //-> While inactive the audio thread can not hold any impulse response or shared memory region:
+    //-> the convolution stage lets go of its kernels (it restarts from silence), then the
+    //-> replaced ones are released
+    if (!state)
+    {
+        convolution.reset(convolutionKernels);
+        convolutionKernels.collect(true);
+        sharedTable = nullptr;
+        sharedData.collect(true);
+    }
 
     //-> Call our parent setActive function
     return AudioEffect::setActive(state);
@@ -97,6 +188,38 @@ tresult PLUGIN_API AGain::setActive(TBool state)
 //-------------->AGain process function
 
 tresult PLUGIN_API AGain::process(ProcessData& data)
+{
+    //-> Debug builds with AGAIN_ASSERT_NO_ALLOCATIONS=1 assert on any heap allocation from here on
+    ScopedNoAllocation noAllocation;
+
+    //-> AGAIN_PERF_COUNTERS=1: hardware counters of this call (see againperfcounters.h)
+    PerfCounterScope perfCounterScope(perfCounters, hot.kernelVariant, data.numSamples);
+
+    //-> AGAIN_REBLOCK_FRAMES: the host blocks go through a FIFO, processBlock () only sees blocks
+    //-> of that size (see againreblock.h), parameter flushes without busses wait in the same FIFO
+    if (reblocker.isActive())
+    {
+        if (data.numInputs == 0 || data.numOutputs == 0)
+        {
+            reblocker.queue(data);
+            return kResultOk;
+        }
+        return reblocker.process(data, [this](ProcessData& block) { return processBlock(block); });
+    }
+
+    //-> Blocks larger than announced in setupProcessing are processed in parts our buffers are
+    //-> sized for (see againreblock.h), so no stage (the sidechain detector...) has to skip them
+    int32 maxFrames = processSetup.maxSamplesPerBlock;
+    if (maxFrames > 0 && data.numSamples > maxFrames && data.numInputs > 0 && data.numOutputs > 0)
+    {
+        return blockSplitter.process(data, maxFrames,
+            [this](ProcessData& part) { return processBlock(part); });
+    }
+    return processBlock(data);
+}
+
+//------------------------------------------------------------------------
+tresult AGain::processBlock(ProcessData& data)
 {
     //-> Finally, the process function
     //-> In this example, there are 4 steps:
@@ -105,11 +228,26 @@ tresult PLUGIN_API AGain::process(ProcessData& data)
     //-> 3) Process the gain of the input buffer to the output buffer
     //-> 4) Write the new VU meter value to the output parameters queue
 
+    //-> Pick up the changes of setState/receiveText (only one atomic load if there are none)
+    bool parametersChanged = false;
+    if (const ParameterSnapshot* snapshot = parameterMailbox.fetch())
+    {
+        snapshot->applyTo(hot);
+        programSwitch.applied(*snapshot);
+        parametersChanged = true;
+    }
+
+    //-> The newest data region of the controller (one atomic load, valid for this block)
+    sharedTable = sharedData.acquire();
+
     //-> Step 1: Read input parameter changes
 
-    if (IParameterChanges* paramChanges = data.inputParameterChanges)
+    IParameterChanges* paramChanges = data.inputParameterChanges;
+    int32 numParamsChanged = paramChanges ? paramChanges->getParameterCount() : 0;
+    //-> Most blocks carry no changes, their queue loop is skipped entirely
+    if (numParamsChanged > 0)
     {
-        int32 numParamsChanged = paramChanges->getParameterCount();
+        parametersChanged = true;
         //-> For each parameter that has changes in this audio block:
         for (int32 i = 0; i < numParamsChanged; i++)
         {
@@ -125,14 +263,46 @@ tresult PLUGIN_API AGain::process(ProcessData& data)
                         //-> Use the last point of the queue (in this example) to update the gain value
                         if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) == kResultTrue)
                         {
-                            fGain = (float)value;
+                            hot.fGain = (float)value;
                         }
                         break;
                     case kBypassId:
                         //-> Use the last point of the queue (in this example) to update the bypass value
                         if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) == kResultTrue)
                         {
-                            bBypass = (value > 0.5f);
+                            hot.bBypass = (value > 0.5f);
+                        }
+                        break;
+                    case kSaturationId:
+                        //-> Off, 2x, 4x or 8x oversampled saturation (changes our latency)
+                        if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) == kResultTrue)
+                        {
+                            hot.saturationMode = saturationModeFromNormalized(value);
+                        }
+                        break;
+                    case kSidechainDepthId:
+                        if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) == kResultTrue)
+                        {
+                            hot.fSidechainDepth = (float)value;
+                        }
+                        break;
+                    case kSidechainAttackId:
+                        if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) == kResultTrue)
+                        {
+                            hot.fSidechainAttack = value;
+                        }
+                        break;
+                    case kSidechainReleaseId:
+                        if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) == kResultTrue)
+                        {
+                            hot.fSidechainRelease = value;
+                        }
+                        break;
+                    case kProgramId:
+                        //-> Precompiled program snapshot, its gain fades in from the sample offset
+                        if (paramQueue->getPoint(numPoints - 1, sampleOffset, value) == kResultTrue)
+                        {
+                            programSwitch.select(programFromNormalized(value), sampleOffset, hot);
                         }
                         break;
                 }
@@ -140,10 +310,12 @@ tresult PLUGIN_API AGain::process(ProcessData& data)
         }
     }
 
-    //-> Step 2: Read input events
-    if (IEventList* eventList = data.inputEvents)
+    //-> Step 2: Read input events (none arrive while the event input is inactive)
+    IEventList* eventList = hot.bEventInputActive ? data.inputEvents : nullptr;
+    int32 numEvent = eventList ? eventList->getEventCount() : 0;
+    if (numEvent > 0)
     {
-        int32 numEvent = eventList->getEventCount();
+        parametersChanged = true;
         for (int32 i = 0; i < numEvent; i++)
         {
             Event event;
@@ -154,17 +326,38 @@ tresult PLUGIN_API AGain::process(ProcessData& data)
                 {
                     case Event::kNoteOnEvent:
                         //-> Use the velocity of the Note On event to apply gain reduction
-                        fGainReduction = event.noteOn.velocity;
+                        hot.fGainReduction = event.noteOn.velocity;
                         break;
                     case Event::kNoteOffEvent:
                         //-> Note Off event resets the gain reduction
-                        fGainReduction = 0.f;
+                        hot.fGainReduction = 0.f;
                         break;
                 }
             }
         }
     }
 
+    //-> Only when something changed in this block: make our current values visible to getState and
+    //-> apply a new saturation mode (it resets the oversampling filters) and envelope times
+    if (parametersChanged)
+    {
+        parameterMailbox.publishFromAudio(hot);
+        saturation.setMode(hot.saturationMode);
+        envelope.setTimes(hot.fSidechainAttack, hot.fSidechainRelease);
+    }
+
+    //-> The meter is only computed while an editor is open or the host writes the automation of
+    //-> the outputs (see againmeterdemand.h). After a pause it restarts from a clean state and
+    //-> its first value is always sent.
+    bool meterResumed = false;
+    bool metering = meterDemand.update(meterResumed);
+    if (meterResumed)
+    {
+        meterThrottle.reset();
+        analysisWorker.resetVuPPM();
+        hot.fVuPPMOld = -1.f;
+    }
+
     // Step 3: Process Audio
     if (data.numInputs == 0 || data.numOutputs == 0)
     {
@@ -172,24 +365,76 @@ tresult PLUGIN_API AGain::process(ProcessData& data)
         return kResultOk;
     }
 
-    int32 numChannels = data.inputs[0].numChannels;
+    //-> Different input and output arrangements (1->2, 2->1, 5.1->2,...) are mixed by the pipelines,
+    //-> everything else works on the output channels (numChannels)
+    int32 numInChannels = data.inputs[0].numChannels;
+    int32 numChannels = data.outputs[0].numChannels;
+    bool mixing = numInChannels != numChannels && mix.numInputs == numInChannels &&
+        mix.numOutputs == numChannels;
+    if (!mixing)
+    {
+        numChannels = std::min(numChannels, numInChannels);
+    }
 
     //-> Get audio buffers
-    uint32 sampleFramesSize = getSampleFramesSizeInBytes(processSetup, data.numSamples);
-    void** in = getChannelBuffersPointer(processSetup, data.inputs[0]);
-    void** out = getChannelBuffersPointer(processSetup, data.outputs[0]);
+    uint32 sampleFramesSize = setupCache.getFramesSize(data.numSamples);
+    void** in = ProcessSetupCache::getBuffers(data.inputs[0]);
+    void** out = ProcessSetupCache::getBuffers(data.outputs[0]);
     float fVuPPM = 0.f;
 
-    //-> Check if all channels are silent, then process as silent
-    if (data.inputs[0].silenceFlags == getChannelMask(data.inputs[0].numChannels))
+    //-> The sidechain is only used when the host activated its bus and provides buffers (process ()
+    //-> splits larger blocks than the envelope buffer is sized for)
+    void** sideChain = nullptr;
+    int32 numSideChainChannels = 0;
+    if (hot.bSideChainActive && data.numInputs > 1 && data.inputs[1].numChannels > 0 &&
+        data.numSamples <= envelope.getMaxFrames())
+    {
+        sideChain = ProcessSetupCache::getBuffers(data.inputs[1]);
+        numSideChainChannels = data.inputs[1].numChannels;
+    }
+
+    //-> The sidechain detector runs in every block (silent input, bypass, muted gain too), so its
+    //-> envelope follows the sidechain and the gain reduction is right when the signal returns
+    float gain = getBlockGain(hot);
+    const float* sideChainGains = nullptr;
+    if (sideChain)
+    {
+        if (hot.quality.doubleEnvelope)
+        {
+            if (data.symbolicSampleSize == kSample32)
+                sideChainGains = envelope.process<Sample32, double>((Sample32**)sideChain,
+                    numSideChainChannels, data.numSamples, gain, hot.fSidechainDepth);
+            else
+                sideChainGains = envelope.process<Sample64, double>((Sample64**)sideChain,
+                    numSideChainChannels, data.numSamples, gain, hot.fSidechainDepth);
+        }
+        else if (data.symbolicSampleSize == kSample32)
+            sideChainGains = envelope.process<Sample32>((Sample32**)sideChain, numSideChainChannels,
+                data.numSamples, gain, hot.fSidechainDepth);
+        else
+            sideChainGains = envelope.process<Sample64>((Sample64**)sideChain, numSideChainChannels,
+                data.numSamples, gain, hot.fSidechainDepth);
+    }
+
+    //-> Check if all channels are silent, then process as silent (once the saturation has played out
+    //-> its latency tail, see below)
+    bool inputSilent =
+        data.inputs[0].silenceFlags == setupCache.getInputMask(data.inputs[0].numChannels);
+
+    //-> A program change fade only runs with the gain, bypassed or silent blocks end it
+    if (hot.bBypass || inputSilent)
+    {
+        programSwitch.endFade();
+    }
+    if (inputSilent && (!saturation.isActive() || saturation.isSettled()))
     {
         //-> Mark output as silent too (it will help the host to propagate the silence)
-        data.outputs[0].silenceFlags = data.inputs[0].silenceFlags;
+        data.outputs[0].silenceFlags = setupCache.getOutputMask(data.outputs[0].numChannels);
 
         //-> If the input buffers are not the same as the output buffers, clear the output buffers
         for (int32 i = 0; i < numChannels; i++)
         {
-            if (in[i] != out[i])
+            if (i >= numInChannels || in[i] != out[i])
             {
                 memset(out[i], 0, sampleFramesSize);
             }
@@ -197,77 +442,221 @@ tresult PLUGIN_API AGain::process(ProcessData& data)
         //-> Set the VU Meter value to 0 in this case
         fVuPPM = 0.f;
     }
+    else if (inputSilent)
+    {
+        //-> The oversampling filters (or the bypass delay line) still hold the end of the last
+        //-> signal: silence is fed through them until it has left
+        data.outputs[0].silenceFlags = 0;
+        if (data.symbolicSampleSize == kSample32)
+            fVuPPM = saturation.processSilence<Sample32>((Sample32**)out, numChannels,
+                data.numSamples, hot.bBypass);
+        else
+            fVuPPM = (float)saturation.processSilence<Sample64>((Sample64**)out, numChannels,
+                data.numSamples, hot.bBypass);
+        if (!metering || hot.quality.offloadAnalysis)
+            fVuPPM = 0.f;
+    }
     else // We have to process (no silence)
     {
         //-> Mark our outputs as not silent
         data.outputs[0].silenceFlags = 0;
 
-        //-> If in bypass mode, the outputs should be like the inputs (copy input to output)
-        if (bBypass)
+        //-> The sample by sample stages (gain, sanitizer, meter) run fused in one pass over the
+        //-> buffers, the options of this block select one of the pre-instantiated pipelines
+        uint32 pipelineFlags = 0;
+        if (hot.quality.sanitizeOutput)
+            pipelineFlags |= kPipelineSanitize;
+        if (hot.quality.absolutePeakMetering)
+            pipelineFlags |= kPipelineAbsoluteMeter;
+        if (hot.quality.offloadAnalysis || !metering)
+            pipelineFlags |= kPipelineNoMeter;
+        //-> Chosen by the autotuner (a mix keeps computing in double)
+        if (hot.quality.floatCompute && data.symbolicSampleSize == kSample64)
+            pipelineFlags |= kPipelineFloatCompute;
+        KernelVariant kernelVariant = (KernelVariant)hot.kernelVariant;
+        PipelineContext pipelineContext;
+        bool pipelineMetered = false;
+
+        //-> Mixing: the pipelines apply the mix matrix together with the gain in the same pass. The
+        //-> saturation needs the output channels as its input, they are mixed first (unity gain).
+        void** stageIn = in;
+        if (mixing)
         {
-            for (int32 i = 0; i < numChannels; i++)
+            pipelineContext.mix = &mix;
+            if (saturation.isActive())
             {
-                if (in[i] != out[i])
-                {
-                    //-> Copy the input buffer to the output buffer
-                    memcpy(out[i], in[i], sampleFramesSize);
-                }
+                uint32 mixFlags = kPipelineBypass | kPipelineMix | kPipelineNoMeter;
+                if (data.symbolicSampleSize == kSample32)
+                    getPipeline<Sample32>(mixFlags, kernelVariant)((Sample32**)in, (Sample32**)out,
+                        numChannels, data.numSamples, hot.tileFrames, pipelineContext);
+                else
+                    getPipeline<Sample64>(mixFlags, kernelVariant)((Sample64**)in, (Sample64**)out,
+                        numChannels, data.numSamples, hot.tileFrames, pipelineContext);
+                stageIn = out;
             }
+            else
+            {
+                pipelineFlags |= kPipelineMix;
+            }
+        }
 
-            //-> Calculate the VU Meter value based on the input samples
+        //-> If in bypass mode, the outputs should be like the inputs (copy input to output)
+        //-> With saturation the bypassed signal is delayed by our latency to stay time aligned
+        if (hot.bBypass && saturation.isActive())
+        {
+            if (data.symbolicSampleSize == kSample32)
+                saturation.processBypass<Sample32>((Sample32**)stageIn, (Sample32**)out,
+                    numChannels, data.numSamples);
+            else
+                saturation.processBypass<Sample64>((Sample64**)stageIn, (Sample64**)out,
+                    numChannels, data.numSamples);
+
+            if (hot.quality.offloadAnalysis || !metering)
+                pipelineMetered = true;
+            else if (data.symbolicSampleSize == kSample32)
+                fVuPPM = processVuPPM<Sample32>((Sample32**)out, numChannels, data.numSamples);
+            else
+                fVuPPM = processVuPPM<Sample64>((Sample64**)out, numChannels, data.numSamples);
+        }
+        else if (hot.bBypass)
+        {
+            //-> Copy the input buffer to the output buffer and calculate the VU Meter value based on
+            //-> the input samples, both tile by tile while the data is in the cache
+            pipelineFlags |= kPipelineBypass;
             if (data.symbolicSampleSize == kSample32)
-                fVuPPM = processVuPPM<Sample32>((Sample32**)in, numChannels, data.numSamples);
+                fVuPPM = getPipeline<Sample32>(pipelineFlags, kernelVariant)(
+                    (Sample32**)in, (Sample32**)out, numChannels, data.numSamples,
+                    hot.tileFrames, pipelineContext);
             else
-                fVuPPM = processVuPPM<Sample64>((Sample64**)in, numChannels, data.numSamples);
+                fVuPPM = getPipeline<Sample64>(pipelineFlags, kernelVariant)(
+                    (Sample64**)in, (Sample64**)out, numChannels, data.numSamples,
+                    hot.tileFrames, pipelineContext);
+            pipelineMetered = true;
         }
         else
         {
-            //-> Apply gain factor to the input buffer to the output buffer
-            float gain = (fGain - fGainReduction);
-            if (bHalfGain)
+            //-> Apply gain factor to the input buffer to the output buffer. With a sidechain, the
+            //-> gain of each frame is reduced by its envelope (stereo linked, computed above)
+            const float* gains = gain >= 0.0000001 ? sideChainGains : nullptr;
+
+            //-> After a program change the gain of each frame fades from the old to the new gain
+            if (programSwitch.isFading() && data.numSamples <= programSwitch.getMaxFrames())
             {
-                gain = gain * 0.5f;
+                gains = programSwitch.process(gains, gain, data.numSamples);
             }
 
             //-> If the applied gain is nearly zero, set the output buffers to zero and set silence flags
-            if (gain < 0.0000001)
+            if (gain < 0.0000001 && !gains)
             {
                 for (int32 i = 0; i < numChannels; i++)
                 {
                     memset(out[i], 0, sampleFramesSize);
                 }
                 //-> Set the silence flags to 1 for all channels
-                data.outputs[0].silenceFlags = getChannelMask(data.outputs[0].numChannels);
+                data.outputs[0].silenceFlags =
+                    setupCache.getOutputMask(data.outputs[0].numChannels);
+            }
+            else if (saturation.isActive()) //-> Gain followed by the oversampled soft saturation
+            {
+                if (data.symbolicSampleSize == kSample32)
+                    fVuPPM = saturation.process<Sample32>((Sample32**)stageIn, (Sample32**)out, numChannels,
+                        data.numSamples, gain, gains);
+                else
+                    fVuPPM = saturation.process<Sample64>((Sample64**)stageIn, (Sample64**)out, numChannels,
+                        data.numSamples, gain, gains);
             }
-            else //-> Process audio with the applied gain factor
+            else //-> Gain (of each frame with a sidechain) and meter, tile by tile (see againtiling.h)
             {
+                pipelineContext.gain = gain;
+                pipelineContext.gains = gains;
+                if (gains)
+                    pipelineFlags |= kPipelineFrameGains;
                 if (data.symbolicSampleSize == kSample32)
-                    fVuPPM = processAudio<Sample32>((Sample32**)in, (Sample32**)out, numChannels,
-                        data.numSamples, gain);
+                    fVuPPM = getPipeline<Sample32>(pipelineFlags, kernelVariant)(
+                        (Sample32**)in, (Sample32**)out, numChannels, data.numSamples,
+                        hot.tileFrames, pipelineContext);
                 else
-                    fVuPPM = processAudio<Sample64>((Sample64**)in, (Sample64**)out, numChannels,
-                        data.numSamples, gain);
+                    fVuPPM = getPipeline<Sample64>(pipelineFlags, kernelVariant)(
+                        (Sample64**)in, (Sample64**)out, numChannels, data.numSamples,
+                        hot.tileFrames, pipelineContext);
+                pipelineMetered = true;
             }
         }
+
+        //-> Offline: higher resolution metering (absolute peak of the output, one more pass when
+        //-> the pipeline did not already measure it)
+        if (metering && hot.quality.absolutePeakMetering && !pipelineMetered)
+        {
+            if (data.symbolicSampleSize == kSample32)
+                fVuPPM = processVuPPMAbsolute<Sample32>((Sample32**)out, numChannels, data.numSamples);
+            else
+                fVuPPM = (float)processVuPPMAbsolute<Sample64>((Sample64**)out, numChannels,
+                    data.numSamples);
+        }
+    }
+
+    //-> Post gain convolution with the impulse response received from the controller. It keeps
+    //-> ringing after the input became silent, so the output is never marked silent while active.
+    if (!hot.bBypass && convolution.isActive(convolutionKernels))
+    {
+        data.outputs[0].silenceFlags = 0;
+        if (data.symbolicSampleSize == kSample32)
+        {
+            convolution.process<Sample32>(convolutionKernels, (Sample32**)out, numChannels,
+                data.numSamples);
+            if (metering && !hot.quality.offloadAnalysis)
+                fVuPPM = hot.quality.absolutePeakMetering ?
+                    processVuPPMAbsolute<Sample32>((Sample32**)out, numChannels, data.numSamples) :
+                    processVuPPM<Sample32>((Sample32**)out, numChannels, data.numSamples);
+        }
+        else
+        {
+            convolution.process<Sample64>(convolutionKernels, (Sample64**)out, numChannels,
+                data.numSamples);
+            if (metering && !hot.quality.offloadAnalysis)
+                fVuPPM = (float)(hot.quality.absolutePeakMetering ?
+                    processVuPPMAbsolute<Sample64>((Sample64**)out, numChannels, data.numSamples) :
+                    processVuPPM<Sample64>((Sample64**)out, numChannels, data.numSamples));
+        }
+    }
+    else if (hot.bBypass)
+    {
+        //-> Bypassed: the convolution history is dropped, the stage fades in again from silence
+        convolution.reset(convolutionKernels);
+    }
+
+    //-> Offloaded analysis: the audio thread only copies the final output into the ring (silent
+    //-> blocks too, so the meter falls back), the meter is the last one published by the worker
+    if (metering && hot.quality.offloadAnalysis)
+    {
+        if (data.symbolicSampleSize == kSample32)
+            analysisRing.push<Sample32>((Sample32**)out, numChannels, data.numSamples);
+        else
+            analysisRing.push<Sample64>((Sample64**)out, numChannels, data.numSamples);
+        fVuPPM = analysisWorker.getVuPPM();
     }
 
-    //-> Step 4: Write outputs parameter changes
-    IParameterChanges* outParamChanges = data.outputParameterChanges;
-    //-> If there are output parameter changes and the VU Meter value has changed
-    if (outParamChanges && fVuPPMOld != fVuPPM)
+    //-> Step 4: Write outputs parameter changes (for small blocks only every kMeterReportFrames,
+    //-> with the peak of the blocks in between)
+    if (metering && meterThrottle.update(fVuPPM, data.numSamples, fVuPPM))
     {
-        int32 index = 0;
-        //-> Add a new value of VU Meter to the output parameter changes
-        IParamValueQueue* paramQueue = outParamChanges->addParameterData(kVuPPMId, index);
-        if (paramQueue)
+        IParameterChanges* outParamChanges = data.outputParameterChanges;
+        //-> If there are output parameter changes and the VU Meter value has changed
+        if (outParamChanges && hot.fVuPPMOld != fVuPPM)
         {
-            int32 index2 = 0;
-            //-> Add the VU Meter value to the parameter queue at sample offset 0
-            paramQueue->addPoint(0, fVuPPM, index2);
+            int32 index = 0;
+            //-> Add a new value of VU Meter to the output parameter changes
+            IParamValueQueue* paramQueue = outParamChanges->addParameterData(kVuPPMId, index);
+            if (paramQueue)
+            {
+                int32 index2 = 0;
+                //-> Add the VU Meter value to the parameter queue at sample offset 0
+                paramQueue->addPoint(0, fVuPPM, index2);
+            }
         }
+        //-> Update the old VU Meter value with the current VU Meter value
+        hot.fVuPPMOld = fVuPPM;
     }
-    //-> Update the old VU Meter value with the current VU Meter value
-    fVuPPMOld = fVuPPM;
 
     return kResultOk;
 }
@@ -281,8 +670,12 @@ tresult AGain::receiveText (const char* text)
 	fprintf (stderr, "%s", text);
 	fprintf (stderr, "\n");
 
-	// Toggle the bHalfGain flag (set it to its opposite value)
-	bHalfGain = !bHalfGain;
+	// Toggle the bHalfGain flag (set it to its opposite value), the audio thread picks it up at its
+	// next block
+	parameterMailbox.publish (ParameterSnapshot::kHalfGain,
+	                          [] (ParameterSnapshot& snapshot) {
+		                          snapshot.bHalfGain = !snapshot.bHalfGain;
+	                          });
 
 	// Return kResultOk to indicate successful processing
 	return kResultOk;
@@ -293,54 +686,23 @@ tresult PLUGIN_API AGain::setState (IBStream* state)
 {
 	// called when we load a preset, the model has to be reloaded
 
-	// Create an IBStreamer object to read the state data from the IBStream
-	IBStreamer streamer (state, kLittleEndian);
-
-	// Read the savedGain value from the state data
-	float savedGain = 0.f;
-	if (streamer.readFloat (savedGain) == false)
+	// Decode the whole state first (see againstatemodel.h): if the stream is invalid nothing of
+	// the running state is touched
+	std::unique_ptr<AGainStateModel> model =
+	    AGainStateModel::decode (state, convolutionKernels.getNumChannels ());
+	if (!model)
 		return kResultFalse;
 
-	// Read the savedGainReduction value from the state data
-	float savedGainReduction = 0.f;
-	if (streamer.readFloat (savedGainReduction) == false)
-		return kResultFalse;
+	// Restore the model's state: we are not in the audio thread, the values are handed over
+	// lock-free and applied at the start of the next block
+	const ParameterSnapshot& restored = model->getParameters ();
+	parameterMailbox.publish (restored.fields, [&] (ParameterSnapshot& snapshot) {
+		snapshot.copyFields (restored, restored.fields);
+	});
 
-	// Read the savedBypass value from the state data
-	int32 savedBypass = 0;
-	if (streamer.readInt32 (savedBypass) == false)
-		return kResultFalse;
-
-	// Restore the model's state using the values read from the state data
-	fGain = savedGain;
-	fGainReduction = savedGainReduction;
-	bBypass = savedBypass > 0;
-
-	// Check if we are in the context of loading a project
-	if (Helpers::isProjectState (state) == kResultTrue)
-	{
-		// We are in the project loading context...
-
-		// Example of using the IStreamAttributes interface
-		// Get the IStreamAttributes interface from the state
-		FUnknownPtr<IStreamAttributes> stream (state);
-		if (stream)
-		{
-			// Get the IAttributeList from the IStreamAttributes
-			if (IAttributeList* list = stream->getAttributes ())
-			{
-				// Get the full file path of this state from the attribute list
-				TChar fullPath[1024];
-				memset (fullPath, 0, 1024 * sizeof (TChar));
-				if (list->getString (PresetAttributes::kFilePathStringType, fullPath,
-				                     1024 * sizeof (TChar)) == kResultTrue)
-				{
-					// Here we have the full path of the state file...
-					// You can use this information for any custom processing.
-				}
-			}
-		}
-	}
+	// The impulse response is swapped in (crossfaded) the same way, a state without one unloads
+	// the current one
+	convolutionKernels.publish (model->releaseImpulseResponse ());
 
 	// Return kResultOk to indicate successful processing
 	return kResultOk;
@@ -354,14 +716,31 @@ tresult PLUGIN_API AGain::getState (IBStream* state)
 	// Create an IBStreamer object to write the model state to the IBStream
 	IBStreamer streamer (state, kLittleEndian);
 
+	// We are not in the audio thread: use the values published by the audio thread (plus the
+	// changes it has not picked up yet) instead of the live ones
+	ParameterSnapshot current = parameterMailbox.readCurrent ();
+
 	// Write the fGain value to the state data
-	streamer.writeFloat (fGain);
+	streamer.writeFloat (current.fGain);
 
 	// Write the fGainReduction value to the state data
-	streamer.writeFloat (fGainReduction);
+	streamer.writeFloat (current.fGainReduction);
 
 	// Write the bBypass flag as an int32 value (1 if true, 0 if false)
-	streamer.writeInt32 (bBypass ? 1 : 0);
+	streamer.writeInt32 (current.bBypass ? 1 : 0);
+
+	// Write the saturation mode (appended, so older versions can still read the state)
+	streamer.writeInt32 (current.saturationMode);
+
+	// Write the sidechain settings (normalized values)
+	streamer.writeFloat (current.fSidechainDepth);
+	streamer.writeDouble (current.fSidechainAttack);
+	streamer.writeDouble (current.fSidechainRelease);
+
+	// Write the impulse response of the convolution stage (its message payload)
+	convolutionKernels.readCurrent ([&] (const ConvolutionKernel* kernel) {
+		AGainStateModel::encodeImpulseResponse (state, kernel);
+	});
 
 	// Return kResultOk to indicate successful processing
 	return kResultOk;
@@ -376,69 +755,98 @@ tresult PLUGIN_API AGain::setupProcessing (ProcessSetup& newSetup)
 	// Update the currentProcessMode member variable with the processing mode obtained from newSetup.
 	currentProcessMode = newSetup.processMode;
 
+	// The process mode selects our quality tier: cheapest kernels in realtime, larger tiles for
+	// prefetch and the most accurate processing for offline
+	hot.quality = getQualityOptions (currentProcessMode);
+
+	// All processing buffers live in one arena sized for the current main bus and block size
+	// (setupProcessing is never called in the audio thread, process itself never allocates).
+	// Features which can be switched on while active (saturation, sidechain) are always sized.
+	int32 numInChannels = 2;
+	int32 numOutChannels = 2;
+	if (auto* bus = FCast<AudioBus> (audioInputs.at (0)))
+		numInChannels = SpeakerArr::getChannelCount (bus->getArrangement ());
+	if (auto* bus = FCast<AudioBus> (audioOutputs.at (0)))
+		numOutChannels = SpeakerArr::getChannelCount (bus->getArrangement ());
+
+	// Mix matrix of asymmetric arrangements (see againmix.h), the per channel buffers are sized for
+	// the larger side
+	mix = MixMatrix::create (numInChannels, numOutChannels);
+
+	// Sample size and channel masks which process would otherwise derive in every call
+	setupCache.update (newSetup.symbolicSampleSize, numInChannels, numOutChannels);
+	int32 numChannels = std::max (numInChannels, numOutChannels);
+
+	// The impulse responses keep the input spectra of the convolution for each channel
+	convolutionKernels.setNumChannels (numChannels);
+
+	// With re-blocking (AGAIN_REBLOCK_FRAMES, see againreblock.h) the processing runs on blocks of
+	// reblockFrames, which may be larger than the blocks of the host
+	ProcessSetup blockSetup = newSetup;
+	blockSetup.maxSamplesPerBlock = std::max (newSetup.maxSamplesPerBlock, hot.quality.reblockFrames);
+
+	const char* hugePages = getenv ("AGAIN_HUGE_PAGES");
+	arena.beginMeasure ();
+	setupProcessingBuffers (numChannels, blockSetup);
+	arena.commit (hugePages && atoi (hugePages) > 0);
+	setupProcessingBuffers (numChannels, blockSetup);
+
+	// Tile size for the cache blocked processing, derived from the cache sizes of this machine
+	hot.tileFrames = computeTileFrames (numChannels, newSetup.symbolicSampleSize == kSample64 ?
+	                                                 sizeof (Sample64) : sizeof (Sample32));
+	hot.tileFrames *= hot.quality.tileScale;
+
+	// Kernel variant (instruction set) and tile size measured on this machine for this
+	// configuration, only the first instance of the process pays for the measurement
+	// (kSample64 hosts with AGAIN_FLOAT_COMPUTE=1: float computing pipelines if they are faster)
+	KernelChoice kernels = KernelAutotuner::choose (numChannels, blockSetup.maxSamplesPerBlock,
+	                                                newSetup.symbolicSampleSize == kSample64,
+	                                                hot.tileFrames, hot.quality.floatCompute);
+	hot.kernelVariant = kernels.variant;
+	hot.tileFrames = kernels.tileFrames;
+	hot.quality.floatCompute = kernels.floatCompute;
+
+	// Optional hardware counter instrumentation of each process call (Linux only)
+	const char* perfCounterEnv = getenv ("AGAIN_PERF_COUNTERS");
+	perfCounters.setEnabled (AGAIN_PERF_COUNTERS && perfCounterEnv && atoi (perfCounterEnv) > 0);
+
 	// Call the setupProcessing function of the base class AudioEffect to perform any necessary setup procedures.
 	return AudioEffect::setupProcessing (newSetup);
 }
-//------------------------------------------------------------------------
 
-tresult PLUGIN_API AGain::setBusArrangements(SpeakerArrangement* inputs, int32 numIns,
-                                              SpeakerArrangement* outputs, int32 numOuts)
+//------------------------------------------------------------------------
+void AGain::setupProcessingBuffers (int32 numChannels, const ProcessSetup& newSetup)
 {
-	// This function is called to set the bus arrangements for the plugin.
-	// It is responsible for configuring the audio inputs and outputs based on the host's requirements.
-	
-	if (numIns == 1 && numOuts == 1)
-	{
-		// The host wants Mono => Mono (1 channel -> 1 channel).
-		if (SpeakerArr::getChannelCount(inputs[0]) == 1 && SpeakerArr::getChannelCount(outputs[0]) == 1)
-		{
-			// Check if the bus arrangements are Mono => Mono; if not, recreate the busses with the new arrangements.
-			auto* bus = FCast<AudioBus>(audioInputs.at(0));
-			if (bus)
-			{
-				if (bus->getArrangement() != inputs[0])
-				{
-					getAudioInput(0)->setArrangement(inputs[0]);
-					getAudioInput(0)->setName(STR16("Mono In"));
-					getAudioOutput(0)->setArrangement(inputs[0]);
-					getAudioOutput(0)->setName(STR16("Mono Out"));
-				}
-				return kResultOk;
-			}
-		}
-		// The host wants something else than Mono => Mono.
-		// In this case, we always configure the plugin as Stereo => Stereo.
-		else
-		{
-			auto* bus = FCast<AudioBus>(audioInputs.at(0));
-			if (bus)
-			{
-				tresult result = kResultFalse;
+	// Called twice by setupProcessing: first the arena measures, then it hands out the memory
+	saturation.setup (arena, numChannels, newSetup.maxSamplesPerBlock);
+	envelope.setup (arena, newSetup.sampleRate, newSetup.maxSamplesPerBlock);
+	programSwitch.setup (arena, newSetup.sampleRate, newSetup.maxSamplesPerBlock);
+	convolution.setup (arena, numChannels);
+	analysisRing.setup (arena, numChannels,
+	                    hot.quality.offloadAnalysis ? AnalysisRing::kDefaultCapacityFrames : 0);
+	reblocker.setup (arena, hot.quality.reblockFrames, numChannels, 2, numChannels);
+}
 
-				// The host wants 2->2 (could be LsRs -> LsRs).
-				if (SpeakerArr::getChannelCount(inputs[0]) == 2 && SpeakerArr::getChannelCount(outputs[0]) == 2)
-				{
-					getAudioInput(0)->setArrangement(inputs[0]);
-					getAudioInput(0)->setName(STR16("Stereo In"));
-					getAudioOutput(0)->setArrangement(outputs[0]);
-					getAudioOutput(0)->setName(STR16("Stereo Out"));
-					result = kResultTrue;
-				}
-				// The host wants something different than 1->1 or 2->2; in this case, we want stereo.
-				else if (bus->getArrangement() != SpeakerArr::kStereo)
-				{
-					getAudioInput(0)->setArrangement(SpeakerArr::kStereo);
-					getAudioInput(0)->setName(STR16("Stereo In"));
-					getAudioOutput(0)->setArrangement(SpeakerArr::kStereo);
-					getAudioOutput(0)->setName(STR16("Stereo Out"));
-					result = kResultFalse;
-				}
+//------------------------------------------------------------------------
+static bool isAsymmetricArrangement (SpeakerArrangement input, SpeakerArrangement output)
+{
+	int32 numInputs = SpeakerArr::getChannelCount (input);
+	int32 numOutputs = SpeakerArr::getChannelCount (output);
+	if (numInputs == numOutputs || !MixMatrix::isSupported (numInputs, numOutputs))
+		return false;
+	// the downmix coefficients are for the channel order of k51 only
+	return numInputs != 6 || input == SpeakerArr::k51;
+}
 
-				return result;
-			}
-		}
+//------------------------------------------------------------------------
+static const char16* getBusName (SpeakerArrangement arrangement, bool input)
+{
+	switch (SpeakerArr::getChannelCount (arrangement))
+	{
+		case 1: return input ? STR16 ("Mono In") : STR16 ("Mono Out");
+		case 6: return input ? STR16 ("5.1 In") : STR16 ("5.1 Out");
 	}
-	return kResultFalse;
+	return input ? STR16 ("Stereo In") : STR16 ("Stereo Out");
 }
 
 //------------------------------------------------------------------------
@@ -447,7 +855,23 @@ tresult PLUGIN_API AGain::setBusArrangements(SpeakerArrangement* inputs, int32 n
 {
 	// This function is called to set the bus arrangements for the plugin.
 	// It is responsible for configuring the audio inputs and outputs based on the host's requirements.
-	
+
+	// The second input is the optional sidechain: we accept mono or stereo, the main busses are
+	// handled as before. The sidechain is only changed together with accepted main busses.
+	const bool hasSideChain = numIns == 2;
+	if (hasSideChain)
+	{
+		int32 sideChainChannels = SpeakerArr::getChannelCount(inputs[1]);
+		if (sideChainChannels != 1 && sideChainChannels != 2)
+			return kResultFalse;
+		numIns = 1;
+	}
+	auto applySideChain = [&] (tresult result) {
+		if (hasSideChain && result == kResultTrue)
+			getAudioInput(1)->setArrangement(inputs[1]);
+		return result;
+	};
+
 	if (numIns == 1 && numOuts == 1)
 	{
 		// The host wants Mono => Mono (1 channel -> 1 channel).
@@ -464,10 +888,20 @@ tresult PLUGIN_API AGain::setBusArrangements(SpeakerArrangement* inputs, int32 n
 					getAudioOutput(0)->setArrangement(inputs[0]);
 					getAudioOutput(0)->setName(STR16("Mono Out"));
 				}
-				return kResultOk;
+				return applySideChain(kResultOk);
 			}
 		}
-		// The host wants something else than Mono => Mono.
+		// The host wants Mono => Stereo, Stereo => Mono or 5.1 => Mono/Stereo: the mix pipelines
+		// (see againmix.h) apply the up/downmix together with the gain.
+		else if (isAsymmetricArrangement (inputs[0], outputs[0]))
+		{
+			getAudioInput(0)->setArrangement(inputs[0]);
+			getAudioInput(0)->setName(getBusName(inputs[0], true));
+			getAudioOutput(0)->setArrangement(outputs[0]);
+			getAudioOutput(0)->setName(getBusName(outputs[0], false));
+			return applySideChain(kResultTrue);
+		}
+		// The host wants something else.
 		// In this case, we always configure the plugin as Stereo => Stereo.
 		else
 		{
@@ -495,12 +929,24 @@ tresult PLUGIN_API AGain::setBusArrangements(SpeakerArrangement* inputs, int32 n
 					result = kResultFalse;
 				}
 
-				return result;
+				return applySideChain(result);
 			}
 		}
 	}
 	return kResultFalse;
 }
+
+//------------------------------------------------------------------------
+uint32 PLUGIN_API AGain::getLatencySamples()
+{
+	// The oversampling filters of the saturation add latency, the controller restarts the component
+	// with kLatencyChanged when the saturation mode is changed
+	// (not called in the audio thread: read the mode through the parameter mailbox). The optional
+	// re-blocking FIFO adds one internal block.
+	return SaturationStage::getLatencySamples(parameterMailbox.readCurrent().saturationMode) +
+		reblocker.getLatencySamples();
+}
+
 //------------------------------------------------------------------------
 tresult PLUGIN_API AGain::canProcessSampleSize(int32 symbolicSampleSize)
 {
@@ -522,7 +968,12 @@ tresult PLUGIN_API AGain::canProcessSampleSize(int32 symbolicSampleSize)
 tresult PLUGIN_API AGain::notify(IMessage* message)
 {
 	// This function is called when the plugin receives a notification or message from the host application.
+	// Large payloads (tables, impulse responses) are received as "SharedMemory" message: it only carries
+	// the handle of a shared memory region which is mapped without any copy, acknowledged to the controller
+	// and published to the audio thread with an atomic pointer swap (see againsharedmemory.h).
+	// A "MeterDemand" message from the controller switches the metering on or off (see againmeterdemand.h).
 	// It checks if the received message is of type "BinaryMessage" and extracts binary data from the message.
+	// If "MyData" is an impulse response (see againconvolution.h), it is loaded into the convolution stage.
 	// If the message contains a binary data tag "MyData" with a size of 100 and the second byte is equal to 1,
 	// it prints a message to the standard error stream (stderr) indicating that it received the binary message.
 	// If the message is not of type "BinaryMessage" or does not meet the specified conditions, it calls the base class's notify function.
@@ -530,13 +981,67 @@ tresult PLUGIN_API AGain::notify(IMessage* message)
 	if (!message)
 		return kInvalidArgument;
 
+	if (strcmp(message->getMessageID(), kSharedMemoryMessageID) == 0)
+	{
+		IAttributeList* attributes = message->getAttributes();
+		int64 handle = -1;
+		int64 size = 0;
+		int64 id = 0;
+		if (attributes && attributes->getInt(kSharedMemoryHandleAttr, handle) == kResultOk &&
+		    attributes->getInt(kSharedMemorySizeAttr, size) == kResultOk &&
+		    attributes->getInt(kSharedMemoryIdAttr, id) == kResultOk)
+		{
+			// We are in the UI thread: map the region (with our own descriptor), then the
+			// controller can close its one
+			std::shared_ptr<const SharedMemoryRegion> region(
+			    SharedMemoryRegion::attach(handle, (uint32)size));
+			if (auto ack = owned(allocateMessage()))
+			{
+				ack->setMessageID(kSharedMemoryAckMessageID);
+				ack->getAttributes()->setInt(kSharedMemoryIdAttr, id);
+				sendMessage(ack);
+			}
+			if (!region)
+				return kResultFalse;
+			// An impulse response is prepared here (partition spectra) and swapped in, the kernel
+			// keeps the mapping as its payload. Any other data is swapped in as it is, the audio
+			// thread picks it up at its next block. Neither is copied.
+			if (ConvolutionKernel::isImpulseResponse(region->getData(), region->getSize()))
+				convolutionKernels.publish(convolutionKernels.prepare(
+				    {region, region->getData(), region->getSize()}));
+			else
+				sharedData.publish(std::move(region));
+			return kResultOk;
+		}
+		return kInvalidArgument;
+	}
+
+	if (strcmp(message->getMessageID(), kMeterDemandMessageID) == 0)
+	{
+		// An editor was opened or the last one closed (or the host's automation writing changed):
+		// process starts or stops metering at its next block
+		int64 observed = 1;
+		if (IAttributeList* attributes = message->getAttributes())
+			attributes->getInt(kMeterDemandObservedAttr, observed);
+		meterDemand.setObserved(observed != 0);
+		return kResultOk;
+	}
+
 	if (strcmp(message->getMessageID(), "BinaryMessage") == 0)
 	{
 		const void* data;
 		uint32 size;
 		if (message->getAttributes()->getBinary("MyData", data, size) == kResultOk)
 		{
-			// We are in the UI thread
+			// We are in the UI thread: an impulse response is prepared here and swapped in, the
+			// audio thread crossfades to it at its next partition boundary
+			if (ConvolutionKernel::isImpulseResponse(data, size))
+			{
+				convolutionKernels.publish(
+				    convolutionKernels.prepare(ImpulseResponsePayload::copy(data, size)));
+				return kResultOk;
+			}
+
 			// Size should be 100
 			if (size == 100 && ((char*)data)[1] == 1) // yeah...
 			{
@@ -0,0 +1,455 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againsaturation.h
+// Description : Oversampled soft saturation for the AGain gain stage
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include "againarena.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+enum SaturationMode
+{
+	kSaturationOff = 0,
+	kSaturation2x,
+	kSaturation4x,
+	kSaturation8x,
+
+	kNumSaturationModes
+};
+
+//------------------------------------------------------------------------
+inline int32 saturationModeFromNormalized (double value)
+{
+	int32 mode = static_cast<int32> (value * (kNumSaturationModes - 1) + 0.5);
+	return std::min<int32> (std::max<int32> (mode, kSaturationOff), kNumSaturationModes - 1);
+}
+
+//------------------------------------------------------------------------
+// SaturationCurve: tanh shaping read from a precomputed table with linear interpolation
+//------------------------------------------------------------------------
+class SaturationCurve
+{
+public:
+	static const SaturationCurve& instance ()
+	{
+		static SaturationCurve curve;
+		return curve;
+	}
+
+	inline float operator() (float x) const
+	{
+		float pos = (x + kRange) * kScale;
+		pos = std::min (std::max (pos, 0.f), (float)kTableSize);
+		int32 index = std::min<int32> ((int32)pos, kTableSize - 1);
+		float frac = pos - (float)index;
+		return table[index] + frac * (table[index + 1] - table[index]);
+	}
+
+//------------------------------------------------------------------------
+private:
+	static constexpr int32 kTableSize = 4096;
+	static constexpr float kRange = 4.f; // tanh (4) = 0.9993, we clamp outside
+	static constexpr float kScale = kTableSize / (2.f * kRange);
+
+	SaturationCurve ()
+	{
+		for (int32 i = 0; i <= kTableSize; i++)
+			table[i] = std::tanh ((float)i / kScale - kRange);
+	}
+
+	float table[kTableSize + 1];
+};
+
+//------------------------------------------------------------------------
+// HalfBandStage: polyphase half-band FIR up- and downsampler (factor 2).
+// Samples are interleaved by lanes (kSaturationLanes channels side by side), so each filter tap
+// is one SIMD operation across the channels.
+//------------------------------------------------------------------------
+static constexpr int32 kSaturationLanes = 4;
+static constexpr int32 kHalfBandHalfLength = 8; // N
+static constexpr int32 kHalfBandBranchTaps = 2 * kHalfBandHalfLength; // 4N-1 taps in total
+
+class HalfBandStage
+{
+public:
+	void setup (ProcessArena& arena, int32 maxInputFrames)
+	{
+		historySize = (kHalfBandBranchTaps - 1 + maxInputFrames) * kSaturationLanes;
+		oddSize = (kHalfBandHalfLength + maxInputFrames) * kSaturationLanes;
+		upHistory = arena.allocate<float> (historySize);
+		downEven = arena.allocate<float> (historySize);
+		downOdd = arena.allocate<float> (oddSize);
+	}
+
+	void reset ()
+	{
+		if (!upHistory)
+			return;
+		memset (upHistory, 0, historySize * sizeof (float));
+		memset (downEven, 0, historySize * sizeof (float));
+		memset (downOdd, 0, oddSize * sizeof (float));
+	}
+
+	// in: frames, out: 2 * frames
+	void upsample (const float* in, float* out, int32 frames)
+	{
+		const float* coefs = getCoefficients ();
+		constexpr int32 L = kSaturationLanes;
+		constexpr int32 hist = kHalfBandBranchTaps - 1;
+
+		float* buffer = upHistory;
+		memcpy (buffer + hist * L, in, frames * L * sizeof (float));
+
+		for (int32 n = 0; n < frames; n++)
+		{
+			const float* x = buffer + (hist + n) * L;
+			float acc[L] = {};
+			for (int32 j = 0; j < kHalfBandBranchTaps; j++)
+			{
+				const float* xj = x - j * L;
+				for (int32 l = 0; l < L; l++)
+					acc[l] += coefs[j] * xj[l];
+			}
+			// the other polyphase branch is the center tap only: a pure delay
+			const float* delayed = x - (kHalfBandHalfLength - 1) * L;
+			float* o = out + 2 * n * L;
+			for (int32 l = 0; l < L; l++)
+			{
+				o[l] = acc[l];
+				o[L + l] = delayed[l];
+			}
+		}
+		memmove (buffer, buffer + frames * L, hist * L * sizeof (float));
+	}
+
+	// in: 2 * frames, out: frames
+	void downsample (const float* in, float* out, int32 frames)
+	{
+		const float* coefs = getCoefficients ();
+		constexpr int32 L = kSaturationLanes;
+		constexpr int32 hist = kHalfBandBranchTaps - 1;
+
+		float* even = downEven;
+		float* odd = downOdd;
+		for (int32 n = 0; n < frames; n++)
+		{
+			for (int32 l = 0; l < L; l++)
+			{
+				even[(hist + n) * L + l] = in[2 * n * L + l];
+				odd[(kHalfBandHalfLength + n) * L + l] = in[(2 * n + 1) * L + l];
+			}
+		}
+
+		for (int32 n = 0; n < frames; n++)
+		{
+			const float* e = even + (hist + n) * L;
+			const float* d = odd + n * L;
+			float acc[L];
+			for (int32 l = 0; l < L; l++)
+				acc[l] = d[l];
+			for (int32 j = 0; j < kHalfBandBranchTaps; j++)
+			{
+				const float* ej = e - j * L;
+				for (int32 l = 0; l < L; l++)
+					acc[l] += coefs[j] * ej[l];
+			}
+			for (int32 l = 0; l < L; l++)
+				out[n * L + l] = 0.5f * acc[l];
+		}
+		memmove (even, even + frames * L, hist * L * sizeof (float));
+		memmove (odd, odd + frames * L, kHalfBandHalfLength * L * sizeof (float));
+	}
+
+	// group delay of one up- plus downsampling pair, in samples of the lower rate
+	static constexpr double getLatency () { return kHalfBandBranchTaps - 1; }
+
+//------------------------------------------------------------------------
+private:
+	// branch coefficients (doubled half-band taps), Blackman windowed sinc, DC gain 1
+	static const float* getCoefficients ()
+	{
+		struct Coefficients
+		{
+			float c[kHalfBandBranchTaps];
+			Coefficients ()
+			{
+				const double pi = 3.14159265358979323846;
+				const int32 length = 2 * kHalfBandBranchTaps - 1;
+				double sum = 0.;
+				for (int32 j = 0; j < kHalfBandBranchTaps; j++)
+				{
+					int32 k = 2 * j - kHalfBandBranchTaps + 1; // odd tap index around the center
+					int32 i = k + kHalfBandBranchTaps - 1;
+					double w = 0.42 - 0.5 * cos (2. * pi * i / (length - 1)) +
+					           0.08 * cos (4. * pi * i / (length - 1));
+					double x = pi * k / 2.;
+					c[j] = (float)(sin (x) / x * w);
+					sum += c[j];
+				}
+				for (auto& value : c)
+					value = (float)(value / sum);
+			}
+		};
+		static Coefficients coefficients;
+		return coefficients.c;
+	}
+
+	float* upHistory {nullptr};
+	float* downEven {nullptr};
+	float* downOdd {nullptr};
+	int32 historySize {0};
+	int32 oddSize {0};
+};
+
+//------------------------------------------------------------------------
+// SaturationStage: gain -> upsampling (2x, 4x or 8x) -> tanh curve -> downsampling.
+// All buffers come from the processor's arena in setup (setupProcessing).
+//------------------------------------------------------------------------
+class SaturationStage
+{
+public:
+	static constexpr int32 kMaxStages = 3; // 8x
+
+	void setup (ProcessArena& arena, int32 numChannels, int32 maxSamplesPerBlock)
+	{
+		maxFrames = std::max<int32> (maxSamplesPerBlock, 1);
+		numGroups = (std::max<int32> (numChannels, 1) + kSaturationLanes - 1) / kSaturationLanes;
+		stages = arena.allocate<HalfBandStage> (numGroups * kMaxStages);
+		for (int32 g = 0; g < numGroups; g++)
+		{
+			for (int32 s = 0; s < kMaxStages; s++)
+			{
+				HalfBandStage measureOnly; // the arena is only measuring when stages is nullptr
+				HalfBandStage& stage = stages ? stages[g * kMaxStages + s] : measureOnly;
+				stage.setup (arena, maxFrames << s);
+			}
+		}
+		workA = arena.allocate<float> ((maxFrames << kMaxStages) * kSaturationLanes);
+		workB = arena.allocate<float> ((maxFrames << kMaxStages) * kSaturationLanes);
+
+		delayChannels = numGroups * kSaturationLanes;
+		delayLine = arena.allocate<double> (delayChannels * kMaxDelay);
+		delayPos = 0;
+		silentFrames = kSettleFrames;
+		bypassed = false;
+		SaturationCurve::instance ();
+	}
+
+	// audio thread: a mode change resets the filter states (no allocation)
+	void setMode (int32 newMode)
+	{
+		if (newMode == mode)
+			return;
+		mode = newMode;
+		reset ();
+	}
+
+	int32 getMode () const { return mode; }
+	bool isActive () const { return mode != kSaturationOff; }
+
+	static uint32 getLatencySamples (int32 mode)
+	{
+		double latency = 0.;
+		for (int32 s = 0; s < mode; s++)
+			latency += HalfBandStage::getLatency () / (1 << s);
+		return (uint32)(latency + 0.5);
+	}
+
+	void reset ()
+	{
+		if (!stages)
+			return;
+		resetFilters ();
+		memset (delayLine, 0, delayChannels * kMaxDelay * sizeof (double));
+		silentFrames = kSettleFrames;
+	}
+
+	// true when the filters and the bypass delay line only hold silence: a silent input gives a
+	// silent output without running the stage
+	bool isSettled () const { return silentFrames >= kSettleFrames; }
+
+	// gains (optional): gain per frame (sidechain), replaces gain
+	template <typename SampleType>
+	SampleType process (SampleType** in, SampleType** out, int32 numChannels, int32 sampleFrames,
+	                    float gain, const float* gains = nullptr)
+	{
+		const SaturationCurve& curve = SaturationCurve::instance ();
+		constexpr int32 L = kSaturationLanes;
+		numChannels = std::min<int32> (numChannels, numGroups * L);
+		SampleType vuPPM = 0;
+
+		// the bypass delay line follows the input (before in place processing overwrites it), a
+		// switch to bypass then continues without replaying old samples
+		writeDelayLine (in, numChannels, sampleFrames);
+		bypassed = false;
+		silentFrames = 0;
+
+		for (int32 offset = 0; offset < sampleFrames; offset += maxFrames)
+		{
+			int32 frames = std::min<int32> (sampleFrames - offset, maxFrames);
+			for (int32 g = 0; g * L < numChannels; g++)
+			{
+				int32 firstChannel = g * L;
+				int32 lanes = std::min<int32> (numChannels - firstChannel, L);
+				float* a = workA;
+				float* b = workB;
+
+				// interleave and apply the gain
+				for (int32 l = 0; l < L; l++)
+				{
+					const SampleType* ptrIn = l < lanes ? in[firstChannel + l] + offset : nullptr;
+					if (!ptrIn)
+					{
+						for (int32 n = 0; n < frames; n++)
+							a[n * L + l] = 0.f;
+					}
+					else if (gains)
+					{
+						for (int32 n = 0; n < frames; n++)
+							a[n * L + l] = (float)(ptrIn[n] * gains[offset + n]);
+					}
+					else
+					{
+						for (int32 n = 0; n < frames; n++)
+							a[n * L + l] = (float)(ptrIn[n] * gain);
+					}
+				}
+
+				int32 numFrames = frames;
+				for (int32 s = 0; s < mode; s++)
+				{
+					stages[g * kMaxStages + s].upsample (a, b, numFrames);
+					std::swap (a, b);
+					numFrames *= 2;
+				}
+
+				for (int32 i = 0; i < numFrames * L; i++)
+					a[i] = curve (a[i]);
+
+				for (int32 s = mode - 1; s >= 0; s--)
+				{
+					numFrames /= 2;
+					stages[g * kMaxStages + s].downsample (a, b, numFrames);
+					std::swap (a, b);
+				}
+
+				for (int32 l = 0; l < lanes; l++)
+				{
+					SampleType* ptrOut = out[firstChannel + l] + offset;
+					for (int32 n = 0; n < frames; n++)
+					{
+						SampleType tmp = a[n * L + l];
+						ptrOut[n] = tmp;
+						// check only positive values
+						if (tmp > vuPPM)
+							vuPPM = tmp;
+					}
+				}
+			}
+		}
+		return vuPPM;
+	}
+
+	// bypass has to stay time aligned with the processed signal: delay by the reported latency
+	template <typename SampleType>
+	void processBypass (SampleType** in, SampleType** out, int32 numChannels, int32 sampleFrames)
+	{
+		// the filters are not fed while bypassed: they restart from silence instead of their state
+		// of the last processed block
+		if (!bypassed)
+			resetFilters ();
+		bypassed = true;
+		silentFrames = 0;
+
+		uint32 latency = getLatencySamples (mode);
+		numChannels = std::min<int32> (numChannels, delayChannels);
+		int32 pos = delayPos;
+		for (int32 i = 0; i < numChannels; i++)
+		{
+			double* line = delayLine + i * kMaxDelay;
+			pos = delayPos;
+			for (int32 n = 0; n < sampleFrames; n++)
+			{
+				line[pos] = in[i][n];
+				out[i][n] = (SampleType)line[(pos + kMaxDelay - latency) % kMaxDelay];
+				pos = (pos + 1) % kMaxDelay;
+			}
+		}
+		delayPos = pos;
+	}
+
+	// silent input while not settled: the latency tail of the last block (and the filter history)
+	// is played out by feeding silence, out is cleared and processed in place
+	template <typename SampleType>
+	SampleType processSilence (SampleType** out, int32 numChannels, int32 sampleFrames, bool bypass)
+	{
+		for (int32 i = 0; i < numChannels; i++)
+			memset (out[i], 0, sampleFrames * sizeof (SampleType));
+		int32 settled = silentFrames;
+		SampleType vuPPM = 0;
+		if (bypass)
+			processBypass<SampleType> (out, out, numChannels, sampleFrames);
+		else
+			vuPPM = process<SampleType> (out, out, numChannels, sampleFrames, 1.f);
+		silentFrames = std::min<int32> (settled + sampleFrames, kSettleFrames);
+		return vuPPM;
+	}
+
+//------------------------------------------------------------------------
+private:
+	static constexpr int32 kMaxDelay = 32; // > latency of 8x
+	// longer than the impulse response of the whole up/down filter chain of 8x
+	static constexpr int32 kSettleFrames = 2 * kMaxDelay;
+
+	void resetFilters ()
+	{
+		for (int32 i = 0; i < numGroups * kMaxStages; i++)
+			stages[i].reset ();
+	}
+
+	template <typename SampleType>
+	void writeDelayLine (SampleType** in, int32 numChannels, int32 sampleFrames)
+	{
+		numChannels = std::min<int32> (numChannels, delayChannels);
+		int32 pos = delayPos;
+		for (int32 i = 0; i < numChannels; i++)
+		{
+			double* line = delayLine + i * kMaxDelay;
+			pos = delayPos;
+			for (int32 n = 0; n < sampleFrames; n++)
+			{
+				line[pos] = in[i][n];
+				pos = (pos + 1) % kMaxDelay;
+			}
+		}
+		delayPos = (delayPos + sampleFrames) % kMaxDelay;
+	}
+
+	HalfBandStage* stages {nullptr};
+	float* workA {nullptr};
+	float* workB {nullptr};
+	double* delayLine {nullptr};
+	int32 delayChannels {0};
+	int32 delayPos {0};
+	int32 maxFrames {0};
+	int32 numGroups {0};
+	int32 mode {kSaturationOff};
+	int32 silentFrames {0}; // silence fed since the last signal
+	bool bypassed {false};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,270 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againsharedmemory.h
+// Description : Shared memory channel between AGainController and AGain
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Message sent from the controller to the processor: instead of the payload itself it carries
+// only the handle (file descriptor) and the size of a shared memory region, plus an id.
+// The handle is only valid when controller and processor live in the same process, which is the
+// case for (nearly) all hosts. When no region can be created (other platforms) the data has to be
+// sent with the "BinaryMessage" path instead.
+// The host may deliver the message at any time later, so the controller keeps its descriptor open
+// until the processor answers with "SharedMemoryAck" (same id): from then on the processor has
+// its own descriptor (or has rejected the region) and the controller closes its one.
+static const char* const kSharedMemoryMessageID = "SharedMemory";
+static const char* const kSharedMemoryAckMessageID = "SharedMemoryAck";
+static const char* const kSharedMemoryHandleAttr = "Handle";
+static const char* const kSharedMemorySizeAttr = "Size";
+static const char* const kSharedMemoryIdAttr = "Id";
+
+//------------------------------------------------------------------------
+// SharedMemoryRegion: a memfd (Linux) or POSIX shm (macOS) backed mapping
+//------------------------------------------------------------------------
+class SharedMemoryRegion
+{
+public:
+	// writer side: creates a new writable region, the payload is written directly into getData ()
+	// and the region is sealed before it is sent
+	static SharedMemoryRegion* create (uint32 size)
+	{
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+		if (size == 0)
+			return nullptr;
+		int fd = openAnonymous ();
+		if (fd < 0)
+			return nullptr;
+		if (ftruncate (fd, size) != 0)
+		{
+			close (fd);
+			return nullptr;
+		}
+		void* ptr = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (ptr == MAP_FAILED)
+		{
+			close (fd);
+			return nullptr;
+		}
+		return new SharedMemoryRegion (fd, ptr, size);
+#else
+		return nullptr;
+#endif
+	}
+
+	// reader side: maps (read only) the region referenced by a handle received with a message
+	static SharedMemoryRegion* attach (int64 handle, uint32 size)
+	{
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+		if (handle < 0 || size == 0)
+			return nullptr;
+		// we keep our own descriptor, the sender is free to close its one
+		int fd = dup (static_cast<int> (handle));
+		if (fd < 0)
+			return nullptr;
+		void* ptr = mmap (nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (ptr == MAP_FAILED)
+		{
+			close (fd);
+			return nullptr;
+		}
+		return new SharedMemoryRegion (fd, ptr, size);
+#else
+		return nullptr;
+#endif
+	}
+
+	~SharedMemoryRegion ()
+	{
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+		if (data)
+			munmap (data, size);
+		close (fd);
+#endif
+	}
+
+	// writer side, when the payload is complete: drops the writable mapping (getData () returns
+	// nullptr afterwards), so the content the processor maps can not change anymore. A memfd is
+	// additionally sealed against writes and resizing.
+	void seal ()
+	{
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+		if (data)
+			munmap (data, size);
+		data = nullptr;
+#if SMTG_OS_LINUX && defined(F_ADD_SEALS)
+		fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+#endif
+#endif
+	}
+
+	void* getData () const { return data; }
+	uint32 getSize () const { return size; }
+	int64 getHandle () const { return fd; }
+
+//------------------------------------------------------------------------
+private:
+	SharedMemoryRegion (int fd, void* data, uint32 size) : fd (fd), data (data), size (size) {}
+
+#if SMTG_OS_LINUX || SMTG_OS_MACOS
+	static int openAnonymous ()
+	{
+#if SMTG_OS_LINUX && defined(MFD_CLOEXEC) && defined(MFD_ALLOW_SEALING)
+		int memFd = memfd_create ("again", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+		if (memFd >= 0)
+			return memFd;
+#endif
+		// POSIX shm fallback: the name is removed right away, only the descriptor keeps it alive
+		static std::atomic<uint32> counter {0};
+		char name[64];
+		snprintf (name, sizeof (name), "/again.%d.%u", (int)getpid (), counter.fetch_add (1));
+		int fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0)
+			shm_unlink (name);
+		return fd;
+	}
+#endif
+
+	int fd;
+	void* data;
+	uint32 size;
+};
+
+//------------------------------------------------------------------------
+// SharedDataSlot: processor side, hands the newest mapped region (tables and other data that is
+// not an impulse response) over to the audio thread with an atomic pointer swap. The mapping
+// stays the owner of the data, nothing is copied. Like ConvolutionKernelSlot every published
+// region gets a sequence number and the audio thread publishes the one it uses; replaced regions
+// older than that are unmapped from a non realtime thread.
+//------------------------------------------------------------------------
+class SharedDataSlot
+{
+public:
+	~SharedDataSlot () { clear (); }
+
+	// non realtime threads (nullptr releases the current region)
+	void publish (std::shared_ptr<const SharedMemoryRegion> region)
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		Entry* entry = region ? new Entry {std::move (region), ++sequence} : nullptr;
+		Entry* old = current.exchange (entry);
+		if (old)
+			retired.push_back (old);
+		collectLocked (false);
+	}
+
+	// non realtime threads: audioThreadIdle is true when process can not be called (inactive)
+	void collect (bool audioThreadIdle)
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		collectLocked (audioThreadIdle);
+	}
+
+	// non realtime threads, only when process can not be called anymore
+	void clear ()
+	{
+		std::lock_guard<std::mutex> lock (writerMutex);
+		delete current.exchange (nullptr);
+		collectLocked (true);
+	}
+
+	//--- audio thread: once per block, the region stays valid until the next call ---
+	const SharedMemoryRegion* acquire ()
+	{
+		const Entry* entry = current.load (std::memory_order_acquire);
+		if (!entry)
+			return nullptr; // keeps the last sequence: it still protects what may be published
+		inUse.store (entry->sequence, std::memory_order_release);
+		return entry->region.get ();
+	}
+
+//------------------------------------------------------------------------
+private:
+	struct Entry
+	{
+		std::shared_ptr<const SharedMemoryRegion> region;
+		uint64 sequence;
+	};
+
+	void collectLocked (bool audioThreadIdle)
+	{
+		uint64 used = inUse.load (std::memory_order_acquire);
+		for (auto it = retired.begin (); it != retired.end ();)
+		{
+			if (audioThreadIdle || (*it)->sequence < used)
+			{
+				delete *it;
+				it = retired.erase (it);
+			}
+			else
+				++it;
+		}
+	}
+
+	std::mutex writerMutex; // serializes the non realtime threads, never taken by the audio thread
+	std::atomic<Entry*> current {nullptr};
+	std::atomic<uint64> inUse {0};
+	uint64 sequence {0};
+	std::vector<Entry*> retired;
+};
+
+//------------------------------------------------------------------------
+// SharedMemoryOutbox: controller side, the sent regions waiting for their acknowledgement
+// (UI thread only)
+//------------------------------------------------------------------------
+class SharedMemoryOutbox
+{
+public:
+	// takes the ownership, returns the id to send with the region
+	int64 add (SharedMemoryRegion* region)
+	{
+		pending.emplace_back (nextId, std::unique_ptr<SharedMemoryRegion> (region));
+		return nextId++;
+	}
+
+	// the processor has its own descriptor now
+	void acknowledge (int64 id)
+	{
+		for (auto it = pending.begin (); it != pending.end (); ++it)
+		{
+			if (it->first == id)
+			{
+				pending.erase (it);
+				return;
+			}
+		}
+	}
+
+	// terminate: the messages not delivered yet can not be mapped anymore
+	void clear () { pending.clear (); }
+
+//------------------------------------------------------------------------
+private:
+	std::vector<std::pair<int64, std::unique_ptr<SharedMemoryRegion>>> pending;
+	int64 nextId {1};
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againstatemodel.h
+// Description : Complete AGain processor state, decoded before anything is applied
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "againconvolution.h"
+#include "againparamsnapshot.h"
+
+#include "public.sdk/source/vst/vsthelpers.h"
+
+#include "pluginterfaces/base/ibstream.h"
+#include "pluginterfaces/vst/ivstattributes.h"
+#include "pluginterfaces/vst/vstpresetkeys.h" // for use of IStreamAttributes
+
+#include "base/source/fstreamer.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// AGainStateModel: setState decodes the whole stream into a new model first (in the calling
+// thread, never the audio thread). Only a complete model is applied: its parameters through the
+// ParameterMailbox and its impulse response through the ConvolutionKernelSlot, both lock-free
+// swaps the audio thread picks up at its next block, the replaced data is reclaimed outside the
+// audio thread. A stream which can not be decoded leaves the running state untouched.
+//
+// Stream layout (little endian), every field after bypass was appended later and is optional:
+// gain, gainReduction (float), bypass, saturationMode (int32), sidechain depth (float),
+// attack, release (double), impulse response size (int32) followed by its bytes
+//------------------------------------------------------------------------
+class AGainStateModel
+{
+public:
+	// numConvolutionChannels: channels of the processor the impulse response is prepared for
+	static std::unique_ptr<AGainStateModel> decode (IBStream* state, int32 numConvolutionChannels)
+	{
+		std::unique_ptr<AGainStateModel> model (new AGainStateModel);
+		ParameterSnapshot& parameters = model->parameters;
+		parameters.fields = ParameterSnapshot::kGain | ParameterSnapshot::kGainReduction |
+		                    ParameterSnapshot::kBypass | ParameterSnapshot::kSaturationMode |
+		                    ParameterSnapshot::kSidechain;
+
+		IBStreamer streamer (state, kLittleEndian);
+		int32 savedBypass = 0;
+		if (streamer.readFloat (parameters.fGain) == false ||
+		    streamer.readFloat (parameters.fGainReduction) == false ||
+		    streamer.readInt32 (savedBypass) == false)
+			return nullptr;
+		parameters.bBypass = savedBypass > 0;
+
+		// older states end here (the defaults of ParameterSnapshot are used)
+		int32 savedSaturationMode = kSaturationOff;
+		if (streamer.readInt32 (savedSaturationMode))
+		{
+			parameters.saturationMode = std::min<int32> (
+			    std::max<int32> (savedSaturationMode, kSaturationOff), kNumSaturationModes - 1);
+			if (streamer.readFloat (parameters.fSidechainDepth))
+			{
+				streamer.readDouble (parameters.fSidechainAttack);
+				streamer.readDouble (parameters.fSidechainRelease);
+			}
+		}
+
+		// the expensive part (partition spectra) is prepared here as well
+		int32 impulseResponseSize = 0;
+		if (streamer.readInt32 (impulseResponseSize) && impulseResponseSize > 0)
+		{
+			// the size comes from the stream: nothing larger than the largest impulse response
+			// is allocated
+			if (impulseResponseSize > kMaxImpulseResponseSize)
+				return nullptr;
+			std::vector<uint8> payload (impulseResponseSize);
+			if (streamer.readRaw (payload.data (), impulseResponseSize) != impulseResponseSize)
+				return nullptr;
+			model->impulseResponse.reset (ConvolutionKernel::create (
+			    ImpulseResponsePayload::adopt (std::move (payload)), numConvolutionChannels));
+		}
+
+		// Check if we are in the context of loading a project
+		if (Helpers::isProjectState (state) == kResultTrue)
+		{
+			// Example of using the IStreamAttributes interface: get the full file path of this
+			// state from the attribute list, kept with the model for any custom processing
+			FUnknownPtr<IStreamAttributes> stream (state);
+			if (stream)
+			{
+				if (IAttributeList* list = stream->getAttributes ())
+				{
+					TChar fullPath[1024] = {};
+					if (list->getString (PresetAttributes::kFilePathStringType, fullPath,
+					                     1024 * sizeof (TChar)) == kResultTrue)
+						model->presetPath = fullPath;
+				}
+			}
+		}
+		return model;
+	}
+
+	// the impulse response part of getState (the parameters are written by getState itself), the
+	// only place where the payload is copied
+	static void encodeImpulseResponse (IBStream* state, const ConvolutionKernel* kernel)
+	{
+		IBStreamer streamer (state, kLittleEndian);
+		int32 size = kernel ? (int32)kernel->getPayload ().size : 0;
+		streamer.writeInt32 (size);
+		if (size > 0)
+			streamer.writeRaw (kernel->getPayload ().data, size);
+	}
+
+	const ParameterSnapshot& getParameters () const { return parameters; }
+	const std::basic_string<TChar>& getPresetPath () const { return presetPath; }
+
+	// hands the prepared impulse response over (nullptr: the state has none)
+	ConvolutionKernel* releaseImpulseResponse () { return impulseResponse.release (); }
+
+//------------------------------------------------------------------------
+private:
+	AGainStateModel () = default;
+
+	ParameterSnapshot parameters;
+	std::unique_ptr<ConvolutionKernel> impulseResponse;
+	std::basic_string<TChar> presetPath;
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
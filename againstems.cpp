@@ -0,0 +1,278 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againstems.cpp
+// Description : AGain with up to 64 independent stereo busses (stem mode)
+//-----------------------------------------------------------------------------
+#include "againstems.h"
+#include "againautotune.h"
+#include "againmetadata.h"
+#include "againstemscids.h" // for class ids
+
+#include "public.sdk/source/vst/vstaudioprocessoralgo.h"
+
+#include "pluginterfaces/base/ibstream.h"
+#include "pluginterfaces/vst/ivstparameterchanges.h"
+
+#include "base/source/fstreamer.h"
+
+#include <cstring>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+AGainStems::AGainStems ()
+{
+	std::fill (vuPPMOld, vuPPMOld + kNumStemBuses, 0.f);
+	std::fill (busActive, busActive + kNumStemBuses, false);
+
+	setControllerClass (AGainStemsControllerUID);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::initialize (FUnknown* context)
+{
+	tresult result = AudioEffect::initialize (context);
+	if (result != kResultOk)
+		return result;
+
+	// one stereo in/out pair per stem (only the first one is active by default) and the event
+	// input, see againmetadata.h
+	addBussesTo (*this, getStemsMetadata ());
+	busActive[0] = true;
+
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::setBusArrangements (SpeakerArrangement* inputs, int32 numIns,
+                                                   SpeakerArrangement* outputs, int32 numOuts)
+{
+	// every stem is mono => mono or stereo => stereo
+	if (numIns != numOuts || numIns > kNumStemBuses)
+		return kResultFalse;
+
+	for (int32 i = 0; i < numIns; i++)
+	{
+		int32 numChannels = SpeakerArr::getChannelCount (inputs[i]);
+		if (numChannels < 1 || numChannels > 2 ||
+		    SpeakerArr::getChannelCount (outputs[i]) != numChannels)
+			return kResultFalse;
+	}
+
+	for (int32 i = 0; i < numIns; i++)
+	{
+		getAudioInput (i)->setArrangement (inputs[i]);
+		getAudioOutput (i)->setArrangement (outputs[i]);
+	}
+	return kResultTrue;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::activateBus (MediaType type, BusDirection dir, int32 index,
+                                            TBool state)
+{
+	tresult result = AudioEffect::activateBus (type, dir, index, state);
+
+	// called while not processing: a stem is processed when its output bus is active
+	if (result == kResultTrue && type == kAudio && dir == kOutput && index >= 0 &&
+	    index < kNumStemBuses)
+	{
+		busActive[index] = state != 0;
+	}
+	return result;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::canProcessSampleSize (int32 symbolicSampleSize)
+{
+	if (symbolicSampleSize == kSample32 || symbolicSampleSize == kSample64)
+		return kResultTrue;
+	return kResultFalse;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::setupProcessing (ProcessSetup& newSetup)
+{
+	// the pipeline variant and tile size measured for a stereo stem (shared with AGain instances
+	// of the same configuration, see againautotune.h)
+	bool sample64 = newSetup.symbolicSampleSize == kSample64;
+	tileFrames = computeTileFrames (2, sample64 ? sizeof (Sample64) : sizeof (Sample32));
+	KernelChoice kernels =
+	    KernelAutotuner::choose (2, newSetup.maxSamplesPerBlock, sample64, tileFrames);
+	kernelVariant = kernels.variant;
+	tileFrames = kernels.tileFrames;
+
+	return AudioEffect::setupProcessing (newSetup);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::setActive (TBool state)
+{
+	std::fill (vuPPMOld, vuPPMOld + kNumStemBuses, 0.f);
+	return AudioEffect::setActive (state);
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::process (ProcessData& data)
+{
+	// changes from setState (their sequence is published back with our values)
+	bool parametersChanged = false;
+	if (const StemParameters* newParameters = toAudio.fetch ())
+	{
+		parameters = *newParameters;
+		parametersChanged = true;
+	}
+
+	// parameter changes (last point of each queue, as AGain does)
+	if (IParameterChanges* paramChanges = data.inputParameterChanges)
+	{
+		int32 numParamsChanged = paramChanges->getParameterCount ();
+		for (int32 i = 0; i < numParamsChanged; i++)
+		{
+			IParamValueQueue* paramQueue = paramChanges->getParameterData (i);
+			if (!paramQueue)
+				continue;
+			ParamValue value;
+			int32 sampleOffset;
+			if (paramQueue->getPoint (paramQueue->getPointCount () - 1, sampleOffset, value) !=
+			    kResultTrue)
+				continue;
+
+			int32 bus;
+			if (isStemParameter (paramQueue->getParameterId (), kStemGainBaseId, bus))
+				parameters.gain[bus] = (float)value;
+			else if (isStemParameter (paramQueue->getParameterId (), kStemBypassBaseId, bus))
+				parameters.bypass[bus] = value > 0.5;
+			parametersChanged = true;
+		}
+	}
+	if (parametersChanged)
+	{
+		fromAudio.getWriteBuffer () = parameters;
+		fromAudio.publish ();
+	}
+
+	// collect all active stems, then one pass with the same pipeline over all of them
+	StemBusJob jobs[kNumStemBuses];
+	int32 numJobs = 0;
+	float busPeaks[kNumStemBuses] = {};
+	int32 numBuses = std::min<int32> (std::min (data.numInputs, data.numOutputs), kNumStemBuses);
+	for (int32 bus = 0; bus < numBuses; bus++)
+	{
+		AudioBusBuffers& input = data.inputs[bus];
+		AudioBusBuffers& output = data.outputs[bus];
+		if (!busActive[bus] || input.numChannels == 0 || output.numChannels == 0)
+			continue;
+
+		int32 numChannels = std::min (std::min (input.numChannels, output.numChannels), 2);
+		void** in = getChannelBuffersPointer (processSetup, input);
+		void** out = getChannelBuffersPointer (processSetup, output);
+
+		// silent input stays silent (the gain can not change that)
+		if (input.silenceFlags == getChannelMask (input.numChannels))
+		{
+			output.silenceFlags = input.silenceFlags;
+			uint32 sampleFramesSize = getSampleFramesSizeInBytes (processSetup, data.numSamples);
+			for (int32 i = 0; i < numChannels; i++)
+			{
+				if (in[i] != out[i])
+					memset (out[i], 0, sampleFramesSize);
+			}
+			continue;
+		}
+		output.silenceFlags = 0;
+
+		float gain = parameters.bypass[bus] ? 1.f : parameters.gain[bus];
+		jobs[numJobs++] = {in, out, numChannels, gain, bus};
+	}
+
+	if (data.symbolicSampleSize == kSample32)
+		processStemJobs<Sample32> (jobs, numJobs, data.numSamples, tileFrames, kernelVariant,
+		                           busPeaks);
+	else
+		processStemJobs<Sample64> (jobs, numJobs, data.numSamples, tileFrames, kernelVariant,
+		                           busPeaks);
+
+	// one meter per stem
+	IParameterChanges* outParamChanges = data.outputParameterChanges;
+	for (int32 bus = 0; bus < numBuses; bus++)
+	{
+		if (outParamChanges && vuPPMOld[bus] != busPeaks[bus])
+		{
+			int32 index = 0;
+			if (IParamValueQueue* paramQueue =
+			        outParamChanges->addParameterData (kStemVuPPMBaseId + bus, index))
+			{
+				int32 index2 = 0;
+				paramQueue->addPoint (0, busPeaks[bus], index2);
+			}
+		}
+		vuPPMOld[bus] = busPeaks[bus];
+	}
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::setState (IBStream* state)
+{
+	IBStreamer streamer (state, kLittleEndian);
+
+	int32 version = 0;
+	int32 numStems = 0;
+	if (streamer.readInt32 (version) == false || version != kStateVersion)
+		return kResultFalse;
+	if (streamer.readInt32 (numStems) == false || numStems < 0 || numStems > kMaxStemBuses)
+		return kResultFalse;
+
+	// stems beyond our busses (a build with more of them) are skipped
+	StemParameters restored;
+	for (int32 i = 0; i < numStems; i++)
+	{
+		float gain = 1.f;
+		int32 bypass = 0;
+		if (streamer.readFloat (gain) == false || streamer.readInt32 (bypass) == false)
+			return kResultFalse;
+		if (i >= kNumStemBuses)
+			continue;
+		restored.gain[i] = gain;
+		restored.bypass[i] = bypass > 0;
+	}
+
+	// hand the whole model over to the audio thread (picked up at its next block)
+	std::lock_guard<std::mutex> lock (stateMutex);
+	restored.sequence = writerState.sequence + 1;
+	writerState = restored;
+	toAudio.getWriteBuffer () = writerState;
+	toAudio.publish ();
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+tresult PLUGIN_API AGainStems::getState (IBStream* state)
+{
+	std::lock_guard<std::mutex> lock (stateMutex);
+
+	// the values of the audio thread, unless they do not contain the last setState yet (fetching
+	// it is not enough, the audio thread publishes its values later in the block)
+	fromAudio.fetch ();
+	const StemParameters& current = fromAudio.getReadBuffer ().sequence < writerState.sequence ?
+	                                     writerState :
+	                                     fromAudio.getReadBuffer ();
+
+	IBStreamer streamer (state, kLittleEndian);
+	streamer.writeInt32 (kStateVersion);
+	streamer.writeInt32 (kNumStemBuses);
+	for (int32 i = 0; i < kNumStemBuses; i++)
+	{
+		streamer.writeFloat (current.gain[i]);
+		streamer.writeInt32 (current.bypass[i] ? 1 : 0);
+	}
+	return kResultOk;
+}
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,186 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againstems.h
+// Description : AGain with up to 64 independent stereo busses (stem mode)
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "againmidilearn.h"
+#include "againparamsnapshot.h"
+#include "againpipeline.h"
+#include "againtiling.h"
+
+#include "public.sdk/source/vst/vstaudioeffect.h"
+#include "public.sdk/source/vst/vsteditcontroller.h"
+
+#include "pluginterfaces/vst/ivstmidicontrollers.h"
+#include "pluginterfaces/vst/ivstmidilearn.h"
+
+#include <algorithm>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// All busses are declared (mono or stereo in and out), only the first one is active by default:
+// the host activates the ones it uses with activateBus, inactive busses cost nothing.
+// The number of busses is a build option: AGAIN_STEM_BUSES (1..kMaxStemBuses, default 64). The
+// parameter ids and the state are laid out for kMaxStemBuses, so builds with different counts
+// load each other's states.
+//------------------------------------------------------------------------
+#ifndef AGAIN_STEM_BUSES
+#define AGAIN_STEM_BUSES 64
+#endif
+
+static constexpr int32 kMaxStemBuses = 64;
+static constexpr int32 kNumStemBuses = AGAIN_STEM_BUSES;
+static_assert (kNumStemBuses >= 1 && kNumStemBuses <= kMaxStemBuses,
+               "AGAIN_STEM_BUSES has to be 1..64");
+
+// parameter ids: base + bus index
+static constexpr ParamID kStemGainBaseId = 1000;
+static constexpr ParamID kStemBypassBaseId = 2000;
+static constexpr ParamID kStemVuPPMBaseId = 3000;
+// (4000: kMidiLearnId, see againmidilearn.h)
+static constexpr UnitID kStemUnitBaseId = 100;
+
+//------------------------------------------------------------------------
+inline bool isStemParameter (ParamID id, ParamID baseId, int32& bus)
+{
+	if (id < baseId || id >= baseId + kNumStemBuses)
+		return false;
+	bus = static_cast<int32> (id - baseId);
+	return true;
+}
+
+//------------------------------------------------------------------------
+// Parameters of all stems, handed between setState/getState and the audio thread with a
+// TripleBuffer (see againparamsnapshot.h)
+//------------------------------------------------------------------------
+struct StemParameters
+{
+	uint64 sequence {0}; // of the last setState contained in these values
+	float gain[kNumStemBuses];
+	bool bypass[kNumStemBuses];
+
+	StemParameters ()
+	{
+		std::fill (gain, gain + kNumStemBuses, 1.f);
+		std::fill (bypass, bypass + kNumStemBuses, false);
+	}
+};
+
+//------------------------------------------------------------------------
+// One entry per active bus, all of them processed by the same pipeline in one pass
+struct StemBusJob
+{
+	void** in;
+	void** out;
+	int32 numChannels;
+	float gain; // 1 when bypassed
+	int32 bus;
+};
+
+//------------------------------------------------------------------------
+// the gain pipeline of AGain (see againpipeline.h) for the kernel variant measured in
+// setupProcessing: per lane peaks and the vector width of the variant for every bus
+template <typename SampleType>
+void processStemJobs (const StemBusJob* jobs, int32 numJobs, int32 sampleFrames,
+                      int32 tileFrames, KernelVariant variant, float* busPeaks)
+{
+	PipelineFunction<SampleType> pipeline = getPipeline<SampleType> (0, variant);
+	PipelineContext context;
+	for (int32 j = 0; j < numJobs; j++)
+	{
+		context.gain = jobs[j].gain;
+		busPeaks[jobs[j].bus] = (float)pipeline (
+		    (SampleType**)jobs[j].in, (SampleType**)jobs[j].out, jobs[j].numChannels,
+		    sampleFrames, tileFrames, context);
+	}
+}
+
+//------------------------------------------------------------------------
+// AGainStems: processor of the stem mode
+//------------------------------------------------------------------------
+class AGainStems : public AudioEffect
+{
+public:
+	AGainStems ();
+
+	static FUnknown* createInstance (void* /*context*/)
+	{
+		return (IAudioProcessor*)new AGainStems;
+	}
+
+	tresult PLUGIN_API initialize (FUnknown* context) SMTG_OVERRIDE;
+	tresult PLUGIN_API setBusArrangements (SpeakerArrangement* inputs, int32 numIns,
+	                                       SpeakerArrangement* outputs,
+	                                       int32 numOuts) SMTG_OVERRIDE;
+	tresult PLUGIN_API activateBus (MediaType type, BusDirection dir, int32 index,
+	                                TBool state) SMTG_OVERRIDE;
+	tresult PLUGIN_API canProcessSampleSize (int32 symbolicSampleSize) SMTG_OVERRIDE;
+	tresult PLUGIN_API setupProcessing (ProcessSetup& newSetup) SMTG_OVERRIDE;
+	tresult PLUGIN_API setActive (TBool state) SMTG_OVERRIDE;
+	tresult PLUGIN_API process (ProcessData& data) SMTG_OVERRIDE;
+	tresult PLUGIN_API setState (IBStream* state) SMTG_OVERRIDE;
+	tresult PLUGIN_API getState (IBStream* state) SMTG_OVERRIDE;
+
+	static constexpr int32 kStateVersion = 1;
+
+//------------------------------------------------------------------------
+protected:
+	StemParameters parameters; // audio thread
+	float vuPPMOld[kNumStemBuses];
+	bool busActive[kNumStemBuses];
+	int32 tileFrames {kMaxTileFrames}; // measured in setupProcessing (see againautotune.h)
+	KernelVariant kernelVariant {kKernelGeneric};
+
+	std::mutex stateMutex; // serializes setState/getState
+	StemParameters writerState;
+	TripleBuffer<StemParameters> toAudio;
+	TripleBuffer<StemParameters> fromAudio;
+};
+
+//------------------------------------------------------------------------
+// AGainStemsController: one unit per stem with its gain, bypass and meter. MIDI controllers can
+// be learned for any of them (by default the volume controller of channel n drives stem n).
+//------------------------------------------------------------------------
+class AGainStemsController : public EditControllerEx1, public IMidiMapping, public IMidiLearn
+{
+public:
+	static FUnknown* createInstance (void* /*context*/)
+	{
+		return (IEditController*)new AGainStemsController;
+	}
+
+	tresult PLUGIN_API initialize (FUnknown* context) SMTG_OVERRIDE;
+	tresult PLUGIN_API setComponentState (IBStream* state) SMTG_OVERRIDE;
+	tresult PLUGIN_API setState (IBStream* state) SMTG_OVERRIDE;
+	tresult PLUGIN_API getState (IBStream* state) SMTG_OVERRIDE;
+	tresult PLUGIN_API setParamNormalized (ParamID tag, ParamValue value) SMTG_OVERRIDE;
+	tresult beginEdit (ParamID tag) SMTG_OVERRIDE;
+
+	//---from IMidiMapping-----------------
+	tresult PLUGIN_API getMidiControllerAssignment (int32 busIndex, int16 channel,
+	                                                CtrlNumber midiControllerNumber,
+	                                                ParamID& tag) SMTG_OVERRIDE;
+
+	//---from IMidiLearn-------------------
+	tresult PLUGIN_API onLiveMIDIControllerInput (int32 busIndex, int16 channel,
+	                                              CtrlNumber midiCC) SMTG_OVERRIDE;
+
+	//---Interface---------
+	OBJ_METHODS (AGainStemsController, EditControllerEx1)
+	tresult PLUGIN_API queryInterface (const char* iid, void** obj) SMTG_OVERRIDE;
+	REFCOUNT_METHODS (EditControllerEx1)
+
+//------------------------------------------------------------------------
+protected:
+	MidiLearnMap midiLearn;
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,21 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againstemscids.h
+// Description : Class ids of the AGain stem mode (AGainStems and AGainStemsController)
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/funknown.h"
+
+namespace Steinberg {
+namespace Vst {
+
+// processor and controller of the stem mode, registered next to AGain (see againentry.cpp)
+static const FUID AGainStemsProcessorUID (0x893D98D5, 0x49A94CD6, 0x91C537EF, 0x576815AF);
+static const FUID AGainStemsControllerUID (0xC15264BE, 0xE1094E99, 0x870BB22C, 0xE069C9AC);
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againtiling.h
+// Description : Tile size of the cache blocked AGain processing (see againpipeline.h)
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "pluginterfaces/base/ftypes.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if SMTG_OS_LINUX
+#include <unistd.h>
+#elif SMTG_OS_MACOS
+#include <sys/sysctl.h>
+#endif
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Cache topology, falls back to common sizes when the system can not tell us
+//------------------------------------------------------------------------
+struct CacheSizes
+{
+	int64 l1Data {32 * 1024};
+	int64 l2 {256 * 1024};
+
+	static const CacheSizes& get ()
+	{
+		static CacheSizes sizes = query ();
+		return sizes;
+	}
+
+private:
+	static CacheSizes query ()
+	{
+		CacheSizes sizes;
+#if SMTG_OS_LINUX && defined(_SC_LEVEL1_DCACHE_SIZE)
+		long l1 = sysconf (_SC_LEVEL1_DCACHE_SIZE);
+		long l2 = sysconf (_SC_LEVEL2_CACHE_SIZE);
+		if (l1 > 0)
+			sizes.l1Data = l1;
+		if (l2 > 0)
+			sizes.l2 = l2;
+#elif SMTG_OS_MACOS
+		int64_t value = 0;
+		size_t size = sizeof (value);
+		if (sysctlbyname ("hw.l1dcachesize", &value, &size, nullptr, 0) == 0 && value > 0)
+			sizes.l1Data = value;
+		size = sizeof (value);
+		if (sysctlbyname ("hw.l2cachesize", &value, &size, nullptr, 0) == 0 && value > 0)
+			sizes.l2 = value;
+#endif
+		return sizes;
+	}
+};
+
+//------------------------------------------------------------------------
+static constexpr int32 kMinTileFrames = 64;
+static constexpr int32 kMaxTileFrames = 4096;
+
+//------------------------------------------------------------------------
+// Number of frames per tile: the input and output chunk of one channel have to stay in half of L1
+// and a whole tile (all channels) in half of L2. The environment variable AGAIN_TILE_FRAMES
+// overrides the computed value (rounded and limited the same way).
+inline int32 computeTileFrames (int32 numChannels, int32 bytesPerSample)
+{
+	int64 frames = 0;
+	if (const char* env = getenv ("AGAIN_TILE_FRAMES"))
+		frames = atoi (env);
+	if (frames <= 0)
+	{
+		const CacheSizes& cache = CacheSizes::get ();
+		int64 bytesPerFrame = 2 * bytesPerSample; // input + output
+		int64 bytesPerTileFrame = bytesPerFrame * std::max<int32> (numChannels, 1);
+		frames = std::min<int64> ((cache.l1Data / 2) / bytesPerFrame,
+		                          (cache.l2 / 2) / bytesPerTileFrame);
+	}
+	frames &= ~int64 (15); // keep the tiles aligned for the vector units
+	return (int32)std::min<int64> (std::max<int64> (frames, kMinTileFrames), kMaxTileFrames);
+}
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg
@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------
+// Project     : VST SDK
+//
+// Category    : Examples
+// Filename    : public.sdk/samples/vst/again/source/againuiupdates.h
+// Description : Coalesced controller to editor updates of AGain
+//-----------------------------------------------------------------------------
+#pragma once
+
+#include "public.sdk/source/vst/vstparameters.h"
+
+#include "base/source/fobject.h"
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace Steinberg {
+namespace Vst {
+
+//------------------------------------------------------------------------
+// Every setParamNormalized (host automation, the meter output of the processor) used to notify the
+// editors right away, so the UI thread redrew far more often than the display refreshes. While an
+// editor is open the notifications are only queued instead: each parameter (or message text) is
+// queued once however often it changes, the editors see its latest value at the next flush, which
+// the controller runs on a display rate timer (kFlushIntervalMs). Without an editor there is
+// nobody to notify and everything is delivered right away (UI thread only, like the controller).
+//------------------------------------------------------------------------
+class CoalescedUpdate
+{
+public:
+	virtual ~CoalescedUpdate () = default;
+	virtual void flushUpdate () = 0;
+
+//------------------------------------------------------------------------
+private:
+	friend class CoalescedUpdates;
+	bool pending {false};
+};
+
+//------------------------------------------------------------------------
+class CoalescedUpdates
+{
+public:
+	static constexpr uint32 kFlushIntervalMs = 16; // 60 Hz
+
+	// on while at least one editor is open, switching it off delivers the pending updates
+	void setDeferred (bool state)
+	{
+		deferred = state;
+		if (!deferred)
+			flush ();
+	}
+
+	// returns false if the update has to be delivered by the caller right away
+	bool defer (CoalescedUpdate& update)
+	{
+		if (!deferred)
+			return false;
+		if (!update.pending)
+		{
+			update.pending = true;
+			pending.push_back (&update);
+		}
+		return true;
+	}
+
+	void flush ()
+	{
+		// an update may queue another one (a parameter changing a parameter): next flush
+		flushing.swap (pending);
+		for (CoalescedUpdate* update : flushing)
+		{
+			update->pending = false;
+			update->flushUpdate ();
+		}
+		flushing.clear ();
+	}
+
+	// the controller terminates: its parameters go away, drops what is still queued
+	void clear ()
+	{
+		for (CoalescedUpdate* update : pending)
+			update->pending = false;
+		pending.clear ();
+		deferred = false;
+	}
+
+//------------------------------------------------------------------------
+private:
+	std::vector<CoalescedUpdate*> pending;
+	std::vector<CoalescedUpdate*> flushing;
+	bool deferred {false};
+};
+
+//------------------------------------------------------------------------
+// CoalescedParameter: any Parameter class whose change notification goes through the queue
+//------------------------------------------------------------------------
+template <typename ParameterClass>
+class CoalescedParameter : public ParameterClass, public CoalescedUpdate
+{
+public:
+	template <typename... Args>
+	CoalescedParameter (CoalescedUpdates& updates, Args&&... args)
+	: ParameterClass (std::forward<Args> (args)...), updates (updates)
+	{
+	}
+
+	void changed (int32 msg = IDependent::kChanged) SMTG_OVERRIDE
+	{
+		if (msg != IDependent::kChanged || !updates.defer (*this))
+			ParameterClass::changed (msg);
+	}
+
+	void flushUpdate () SMTG_OVERRIDE { ParameterClass::changed (IDependent::kChanged); }
+
+//------------------------------------------------------------------------
+private:
+	CoalescedUpdates& updates;
+};
+
+//------------------------------------------------------------------------
+// CoalescedCall: a queued function (fan-out of the message text to the editors)
+//------------------------------------------------------------------------
+class CoalescedCall : public CoalescedUpdate
+{
+public:
+	explicit CoalescedCall (std::function<void ()> function) : function (std::move (function)) {}
+
+	void flushUpdate () SMTG_OVERRIDE { function (); }
+
+//------------------------------------------------------------------------
+private:
+	std::function<void ()> function;
+};
+
+//------------------------------------------------------------------------
+} // namespace Vst
+} // namespace Steinberg